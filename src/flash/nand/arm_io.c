@@ -297,3 +297,512 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 
 	return retval;
 }
+
+/**
+ * Uses an on-chip algorithm for an ARM device to read the first OOB bytes
+ * of the first page of a series of NAND blocks, as needed to build the bad
+ * block table.  Each block costs one command/address/wait/read sequence on
+ * the target instead of a series of host driven accesses.  Only 8-bit wide
+ * chips on ARMv4/ARMv5 cores (ARM state) are handled.
+ *
+ * @param io Pointer to the arm_nand_data struct that defines the I/O,
+ *           including the command, address and ready registers
+ * @param nand The NAND device, for its geometry
+ * @param first_block First block to read
+ * @param count Number of blocks to read
+ * @param oob Buffer for @a count times @a oob_size bytes
+ * @param oob_size OOB bytes to read per block
+ * @return Success or failure of the operation; ERROR_NAND_NO_BUFFER if the
+ *         core or the working area can't be used
+ */
+int arm_nand_read_oob(struct arm_nand_data *io, struct nand_device *nand,
+	int first_block, int count, uint8_t *oob, uint32_t oob_size)
+{
+	struct target *target = io->target;
+	struct arm_algorithm armv4_5_algo;
+	struct arm *arm = target->arch_info;
+	struct reg_param reg_params[12];
+	uint32_t pages_per_block = nand->erase_size / nand->page_size;
+	uint32_t target_buf;
+	uint32_t exit_var = 0;
+	uint32_t geometry;
+	int max_count;
+	int retval;
+
+	/* Inputs:
+	 *  r0	NAND command address (byte wide)
+	 *  r1	NAND address address (byte wide)
+	 *  r2	NAND data address (byte wide)
+	 *  r3	ready register address
+	 *  r4	ready mask
+	 *  r5	first page
+	 *  r6	pages per block
+	 *  r7	block count
+	 *  r8	buffer address
+	 *  r9	OOB bytes per block
+	 *  r10	row address cycles | (large page << 8)
+	 *  r11	OOB column (large page)
+	 */
+	static const uint32_t code_armv4_5[] = {
+		0xe31a0c01,	/* b: tst    r10, #0x100       */
+		0x03a0e050,	/*    moveq  lr, #0x50 (READOOB) */
+		0x13a0e000,	/*    movne  lr, #0x00 (READ0) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe5c1b000,	/*    strb   r11, [r1]         */
+		0xe31a0c01,	/*    tst    r10, #0x100       */
+		0x11a0e42b,	/*    lsrne  lr, r11, #8       */
+		0x15c1e000,	/*    strbne lr, [r1]          */
+		0xe20ac0ff,	/*    and    r12, r10, #0xff   */
+		0xe1a0e005,	/*    mov    lr, r5            */
+		0xe5c1e000,	/* r: strb   lr, [r1]          */
+		0xe1a0e42e,	/*    lsr    lr, lr, #8        */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffb,	/*    bne    r                 */
+		0xe31a0c01,	/*    tst    r10, #0x100       */
+		0x13a0e030,	/*    movne  lr, #0x30 (READSTART) */
+		0x15c0e000,	/*    strbne lr, [r0]          */
+		0xe3a0c010,	/*    mov    r12, #16          */
+		0xe593e000,	/* d: ldr    lr, [r3] (let the chip go busy) */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffc,	/*    bne    d                 */
+		0xe593e000,	/* w: ldr    lr, [r3]          */
+		0xe11e0004,	/*    tst    lr, r4            */
+		0x0afffffc,	/*    beq    w                 */
+		0xe1a0c009,	/*    mov    r12, r9           */
+		0xe5d2e000,	/* c: ldrb   lr, [r2]          */
+		0xe4c8e001,	/*    strb   lr, [r8], #1      */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffb,	/*    bne    c                 */
+		0xe0855006,	/*    add    r5, r5, r6        */
+		0xe2577001,	/*    subs   r7, r7, #1        */
+		0x1affffdf,	/*    bne    b                 */
+
+		/* exit: ARMv4 needs hardware breakpoint */
+		0xe1200070,	/* e: bkpt   #0                */
+	};
+
+	if (is_armv7m(target_to_armv7m(target)))
+		return ERROR_NAND_NO_BUFFER;
+
+	if (nand->device->options & NAND_BUSWIDTH_16)
+		return ERROR_NAND_NO_BUFFER;
+
+	armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+	armv4_5_algo.core_mode = ARM_MODE_SVC;
+	armv4_5_algo.core_state = ARM_STATE_ARM;
+
+	/* the code is larger than the read/write loops, the OOB data of as
+	 * many blocks as fit goes behind it */
+	retval = arm_code_to_working_area(target, code_armv4_5, sizeof(code_armv4_5),
+			io->chunk_size, &io->copy_area);
+	if (retval != ERROR_OK)
+		return retval;
+
+	io->op = ARM_NAND_READ_OOB;
+
+	if (io->copy_area->size < sizeof(code_armv4_5) + oob_size)
+		return ERROR_NAND_NO_BUFFER;
+	max_count = (io->copy_area->size - sizeof(code_armv4_5)) / oob_size;
+	target_buf = io->copy_area->address + sizeof(code_armv4_5);
+
+	/* address cycles as in nand_page_command() */
+	if (nand->page_size <= 512)
+		geometry = 2 + (nand->address_cycles >= 4) + (nand->address_cycles >= 5);
+	else
+		geometry = (2 + (nand->address_cycles >= 5)) | 0x100;
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = io->copy_area->address + sizeof(code_armv4_5) - 4;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);
+	init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);
+	init_reg_param(&reg_params[8], "r8", 32, PARAM_OUT);
+	init_reg_param(&reg_params[9], "r9", 32, PARAM_OUT);
+	init_reg_param(&reg_params[10], "r10", 32, PARAM_OUT);
+	init_reg_param(&reg_params[11], "r11", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, io->cmd);
+	buf_set_u32(reg_params[1].value, 0, 32, io->addr);
+	buf_set_u32(reg_params[2].value, 0, 32, io->data);
+	buf_set_u32(reg_params[3].value, 0, 32, io->ready);
+	buf_set_u32(reg_params[4].value, 0, 32, io->ready_mask);
+	buf_set_u32(reg_params[6].value, 0, 32, pages_per_block);
+	buf_set_u32(reg_params[8].value, 0, 32, target_buf);
+	buf_set_u32(reg_params[9].value, 0, 32, oob_size);
+	buf_set_u32(reg_params[10].value, 0, 32, geometry);
+	buf_set_u32(reg_params[11].value, 0, 32, nand->page_size);
+
+	while (count > 0) {
+		int n = MIN(count, max_count);
+
+		buf_set_u32(reg_params[5].value, 0, 32, first_block * pages_per_block);
+		buf_set_u32(reg_params[7].value, 0, 32, n);
+
+		/* a block takes tens of microseconds, allow a millisecond */
+		retval = target_run_algorithm(target, 0, NULL, 12, reg_params,
+				io->copy_area->address, exit_var, 1000 + n, &armv4_5_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND OOB read");
+			break;
+		}
+
+		retval = target_read_buffer(target, target_buf, n * oob_size, oob);
+		if (retval != ERROR_OK)
+			break;
+
+		first_block += n;
+		count -= n;
+		oob += n * oob_size;
+	}
+
+	for (int i = 0; i < 12; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
+/* Pages handled by one run of the page read/write loops. */
+#define ARM_NAND_BATCH_PAGES	32
+
+/**
+ * Common part of arm_nand_write_pages() and arm_nand_read_pages(): makes
+ * sure the working area holds @a code and room for at least one page, and
+ * sets up the register parameters shared by both loops.
+ *
+ * @return The number of pages that fit the working area, or a negative
+ *         error code
+ */
+static int arm_nand_pages_setup(struct arm_nand_data *io, struct nand_device *nand,
+	const uint32_t *code, unsigned code_size, enum arm_nand_op op,
+	int count, uint32_t unit, struct reg_param *reg_params)
+{
+	struct target *target = io->target;
+	uint32_t geometry;
+	int retval;
+
+	if (is_armv7m(target_to_armv7m(target)))
+		return ERROR_NAND_NO_BUFFER;
+
+	if (nand->device->options & NAND_BUSWIDTH_16)
+		return ERROR_NAND_NO_BUFFER;
+
+	/* an area sized for single chunks may be too small for a page and
+	 * its OOB; replace it with one holding a batch of pages if possible */
+	if (io->copy_area && io->copy_area->size < code_size + unit) {
+		target_free_working_area(target, io->copy_area);
+		io->copy_area = NULL;
+	}
+	if (!io->copy_area) {
+		unsigned n = MIN(count, ARM_NAND_BATCH_PAGES);
+
+		if (target_alloc_working_area_try(target, code_size
+				+ MAX(io->chunk_size, n * unit), &io->copy_area) != ERROR_OK)
+			io->copy_area = NULL;
+	}
+
+	retval = arm_code_to_working_area(target, code, code_size,
+			MAX(io->chunk_size, unit), &io->copy_area);
+	if (retval != ERROR_OK)
+		return retval;
+
+	io->op = op;
+
+	/* address cycles as in nand_page_command() */
+	if (nand->page_size <= 512)
+		geometry = 2 + (nand->address_cycles >= 4) + (nand->address_cycles >= 5);
+	else
+		geometry = (2 + (nand->address_cycles >= 5)) | 0x100;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);
+	init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);
+	init_reg_param(&reg_params[8], "r8", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, io->cmd);
+	buf_set_u32(reg_params[1].value, 0, 32, io->addr);
+	buf_set_u32(reg_params[2].value, 0, 32, io->data);
+	buf_set_u32(reg_params[8].value, 0, 32, geometry);
+
+	return MIN((io->copy_area->size - code_size) / unit, ARM_NAND_BATCH_PAGES);
+}
+
+/**
+ * Uses an on-chip algorithm for an ARM device to program a series of
+ * consecutive NAND pages.  Each run of the algorithm takes a batch of
+ * pages from the working area and issues the command, address, data,
+ * program and status sequence for each of them, so the host only has to
+ * download the data and check one status byte per page.  Only 8-bit wide
+ * chips on ARMv4/ARMv5 cores (ARM state) are handled, and no ECC is
+ * computed: @a data must hold each page already laid out as it goes to
+ * the chip.
+ *
+ * @param io Pointer to the arm_nand_data struct that defines the I/O,
+ *           including the command and address registers
+ * @param nand The NAND device, for its geometry
+ * @param page First page to write
+ * @param count Number of pages to write
+ * @param data @a count times @a page_bytes bytes, page data then OOB
+ * @param page_bytes Bytes written to each page
+ * @return Success or failure of the operation; ERROR_NAND_NO_BUFFER if the
+ *         core or the working area can't be used
+ */
+int arm_nand_write_pages(struct arm_nand_data *io, struct nand_device *nand,
+	uint32_t page, int count, uint8_t *data, uint32_t page_bytes)
+{
+	struct target *target = io->target;
+	struct arm_algorithm armv4_5_algo;
+	struct arm *arm = target->arch_info;
+	struct reg_param reg_params[9];
+	uint8_t status[ARM_NAND_BATCH_PAGES];
+	uint32_t target_buf;
+	uint32_t exit_var = 0;
+	int max_count;
+	int retval = ERROR_OK;
+
+	/* Inputs:
+	 *  r0	NAND command address (byte wide)
+	 *  r1	NAND address address (byte wide)
+	 *  r2	NAND data address (byte wide)
+	 *  r3	first page
+	 *  r4	page count
+	 *  r5	buffer address
+	 *  r6	bytes per page
+	 *  r7	status buffer address
+	 *  r8	row address cycles | (large page << 8)
+	 */
+	static const uint32_t code_armv4_5[] = {
+		0xe3a0e080,	/* p: mov    lr, #0x80 (SEQIN) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe3a0e000,	/*    mov    lr, #0            */
+		0xe5c1e000,	/*    strb   lr, [r1]          */
+		0xe3180c01,	/*    tst    r8, #0x100        */
+		0x15c1e000,	/*    strbne lr, [r1]          */
+		0xe208c0ff,	/*    and    r12, r8, #0xff    */
+		0xe1a0e003,	/*    mov    lr, r3            */
+		0xe5c1e000,	/* r: strb   lr, [r1]          */
+		0xe1a0e42e,	/*    lsr    lr, lr, #8        */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffb,	/*    bne    r                 */
+		0xe1a0c006,	/*    mov    r12, r6           */
+		0xe4d5e001,	/* c: ldrb   lr, [r5], #1      */
+		0xe5c2e000,	/*    strb   lr, [r2]          */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffb,	/*    bne    c                 */
+		0xe3a0e010,	/*    mov    lr, #0x10 (PAGEPROG) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe3a0c040,	/*    mov    r12, #64          */
+		0xe25cc001,	/* d: subs   r12, r12, #1 (let the chip go busy) */
+		0x1afffffd,	/*    bne    d                 */
+		0xe3a0e070,	/*    mov    lr, #0x70 (STATUS) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe5d2e000,	/* w: ldrb   lr, [r2]          */
+		0xe31e0040,	/*    tst    lr, #0x40 (ready) */
+		0x0afffffc,	/*    beq    w                 */
+		0xe4c7e001,	/*    strb   lr, [r7], #1      */
+		0xe2833001,	/*    add    r3, r3, #1        */
+		0xe2544001,	/*    subs   r4, r4, #1        */
+		0x1affffe0,	/*    bne    p                 */
+
+		/* exit: ARMv4 needs hardware breakpoint */
+		0xe1200070,	/* e: bkpt   #0                */
+	};
+
+	max_count = arm_nand_pages_setup(io, nand, code_armv4_5, sizeof(code_armv4_5),
+			ARM_NAND_WRITE_PAGES, count, page_bytes + 1, reg_params);
+	if (max_count < 0)
+		return max_count;
+
+	armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+	armv4_5_algo.core_mode = ARM_MODE_SVC;
+	armv4_5_algo.core_state = ARM_STATE_ARM;
+
+	/* page data first, one status byte per page behind it */
+	target_buf = io->copy_area->address + sizeof(code_armv4_5);
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = io->copy_area->address + sizeof(code_armv4_5) - 4;
+
+	buf_set_u32(reg_params[5].value, 0, 32, target_buf);
+	buf_set_u32(reg_params[6].value, 0, 32, page_bytes);
+
+	while (count > 0) {
+		int n = MIN(count, max_count);
+
+		retval = target_write_buffer(target, target_buf, n * page_bytes, data);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[3].value, 0, 32, page);
+		buf_set_u32(reg_params[4].value, 0, 32, n);
+		buf_set_u32(reg_params[7].value, 0, 32, target_buf + n * page_bytes);
+
+		/* programming a page takes well below a millisecond */
+		retval = target_run_algorithm(target, 0, NULL, 9, reg_params,
+				io->copy_area->address, exit_var, 1000 + 10 * n, &armv4_5_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND page write");
+			break;
+		}
+
+		retval = target_read_buffer(target, target_buf + n * page_bytes, n, status);
+		if (retval != ERROR_OK)
+			break;
+
+		for (int i = 0; i < n; i++) {
+			if (status[i] & NAND_STATUS_FAIL) {
+				LOG_ERROR("write operation failed on page %" PRIu32,
+						page + i);
+				retval = ERROR_NAND_OPERATION_FAILED;
+			}
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		page += n;
+		count -= n;
+		data += n * page_bytes;
+	}
+
+	for (int i = 0; i < 9; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
+/**
+ * Uses an on-chip algorithm for an ARM device to read a series of
+ * consecutive NAND pages into the working area, a batch per run, from
+ * where the host uploads them in one transfer.  Same restrictions as
+ * arm_nand_write_pages(); no ECC is checked.
+ *
+ * @param io Pointer to the arm_nand_data struct that defines the I/O,
+ *           including the command and address registers
+ * @param nand The NAND device, for its geometry
+ * @param page First page to read
+ * @param count Number of pages to read
+ * @param data Buffer for @a count times @a page_bytes bytes, page data
+ *             then OOB
+ * @param page_bytes Bytes read from each page
+ * @return Success or failure of the operation; ERROR_NAND_NO_BUFFER if the
+ *         core or the working area can't be used
+ */
+int arm_nand_read_pages(struct arm_nand_data *io, struct nand_device *nand,
+	uint32_t page, int count, uint8_t *data, uint32_t page_bytes)
+{
+	struct target *target = io->target;
+	struct arm_algorithm armv4_5_algo;
+	struct arm *arm = target->arch_info;
+	struct reg_param reg_params[9];
+	uint32_t target_buf;
+	uint32_t exit_var = 0;
+	int max_count;
+	int retval = ERROR_OK;
+
+	/* Inputs:
+	 *  r0	NAND command address (byte wide)
+	 *  r1	NAND address address (byte wide)
+	 *  r2	NAND data address (byte wide)
+	 *  r3	first page
+	 *  r4	page count
+	 *  r5	buffer address
+	 *  r6	bytes per page
+	 *  r8	row address cycles | (large page << 8)
+	 */
+	static const uint32_t code_armv4_5[] = {
+		0xe3a0e000,	/* p: mov    lr, #0x00 (READ0) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe5c1e000,	/*    strb   lr, [r1]          */
+		0xe3180c01,	/*    tst    r8, #0x100        */
+		0x15c1e000,	/*    strbne lr, [r1]          */
+		0xe208c0ff,	/*    and    r12, r8, #0xff    */
+		0xe1a0e003,	/*    mov    lr, r3            */
+		0xe5c1e000,	/* r: strb   lr, [r1]          */
+		0xe1a0e42e,	/*    lsr    lr, lr, #8        */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffb,	/*    bne    r                 */
+		0xe3180c01,	/*    tst    r8, #0x100        */
+		0x13a0e030,	/*    movne  lr, #0x30 (READSTART) */
+		0x15c0e000,	/*    strbne lr, [r0]          */
+		0xe3a0c040,	/*    mov    r12, #64          */
+		0xe25cc001,	/* d: subs   r12, r12, #1 (let the chip go busy) */
+		0x1afffffd,	/*    bne    d                 */
+		0xe3a0e070,	/*    mov    lr, #0x70 (STATUS) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe5d2e000,	/* w: ldrb   lr, [r2]          */
+		0xe31e0040,	/*    tst    lr, #0x40 (ready) */
+		0x0afffffc,	/*    beq    w                 */
+		0xe3a0e000,	/*    mov    lr, #0x00 (READ0, back to data) */
+		0xe5c0e000,	/*    strb   lr, [r0]          */
+		0xe1a0c006,	/*    mov    r12, r6           */
+		0xe5d2e000,	/* c: ldrb   lr, [r2]          */
+		0xe4c5e001,	/*    strb   lr, [r5], #1      */
+		0xe25cc001,	/*    subs   r12, r12, #1      */
+		0x1afffffb,	/*    bne    c                 */
+		0xe2833001,	/*    add    r3, r3, #1        */
+		0xe2544001,	/*    subs   r4, r4, #1        */
+		0x1affffdf,	/*    bne    p                 */
+
+		/* exit: ARMv4 needs hardware breakpoint */
+		0xe1200070,	/* e: bkpt   #0                */
+	};
+
+	max_count = arm_nand_pages_setup(io, nand, code_armv4_5, sizeof(code_armv4_5),
+			ARM_NAND_READ_PAGES, count, page_bytes, reg_params);
+	if (max_count < 0)
+		return max_count;
+
+	armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+	armv4_5_algo.core_mode = ARM_MODE_SVC;
+	armv4_5_algo.core_state = ARM_STATE_ARM;
+
+	target_buf = io->copy_area->address + sizeof(code_armv4_5);
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->is_armv4)
+		exit_var = io->copy_area->address + sizeof(code_armv4_5) - 4;
+
+	/* r7 is not used by this loop */
+	buf_set_u32(reg_params[5].value, 0, 32, target_buf);
+	buf_set_u32(reg_params[6].value, 0, 32, page_bytes);
+	buf_set_u32(reg_params[7].value, 0, 32, 0);
+
+	while (count > 0) {
+		int n = MIN(count, max_count);
+
+		buf_set_u32(reg_params[3].value, 0, 32, page);
+		buf_set_u32(reg_params[4].value, 0, 32, n);
+
+		retval = target_run_algorithm(target, 0, NULL, 9, reg_params,
+				io->copy_area->address, exit_var, 1000 + 10 * n, &armv4_5_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND page read");
+			break;
+		}
+
+		retval = target_read_buffer(target, target_buf, n * page_bytes, data);
+		if (retval != ERROR_OK)
+			break;
+
+		page += n;
+		count -= n;
+		data += n * page_bytes;
+	}
+
+	for (int i = 0; i < 9; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
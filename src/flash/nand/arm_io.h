@@ -24,6 +24,9 @@ enum arm_nand_op {
 	ARM_NAND_NONE,	/**< No operation performed. */
 	ARM_NAND_READ,	/**< Read operation performed. */
 	ARM_NAND_WRITE,	/**< Write operation performed. */
+	ARM_NAND_READ_OOB,	/**< OOB scan performed. */
+	ARM_NAND_WRITE_PAGES,	/**< Page program loop performed. */
+	ARM_NAND_READ_PAGES,	/**< Page read loop performed. */
 };
 
 /**
@@ -43,6 +46,15 @@ struct arm_nand_data {
 	/** Where data is read from or written to. */
 	uint32_t data;
 
+	/** Where commands and addresses are written to (arm_nand_read_oob,
+	 * arm_nand_write_pages, arm_nand_read_pages). */
+	uint32_t cmd;
+	uint32_t addr;
+
+	/** Register polled until a bit in ready_mask is set (arm_nand_read_oob). */
+	uint32_t ready;
+	uint32_t ready_mask;
+
 	/** Last operation executed using this struct. */
 	enum arm_nand_op op;
 
@@ -51,5 +63,11 @@ struct arm_nand_data {
 
 int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size);
 int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size);
+int arm_nand_read_oob(struct arm_nand_data *io, struct nand_device *nand,
+		int first_block, int count, uint8_t *oob, uint32_t oob_size);
+int arm_nand_write_pages(struct arm_nand_data *io, struct nand_device *nand,
+		uint32_t page, int count, uint8_t *data, uint32_t page_bytes);
+int arm_nand_read_pages(struct arm_nand_data *io, struct nand_device *nand,
+		uint32_t page, int count, uint8_t *data, uint32_t page_bytes);
 
 #endif /* OPENOCD_FLASH_NAND_ARM_IO_H */
@@ -24,6 +24,23 @@
 #endif
 
 #include "imp.h"
+#include <helper/fileio.h>
+
+/* magic at the start of a persisted bad block table, see nand_save_bbt() */
+#define NAND_BBT_FILE_MAGIC "OOCDNBBT"
+#define NAND_BBT_FILE_MAGIC_LEN 8
+
+/* block states in a persisted bad block table */
+#define NAND_BBT_GOOD		0x00	/* bad block marker not set */
+#define NAND_BBT_MARKED		0x01	/* bad block marker set */
+#define NAND_BBT_FAILED		0x02	/* failed to erase in use */
+#define NAND_BBT_UNKNOWN	0xff	/* not checked yet */
+
+/* good blocks checked against their OOB before a loaded table is used */
+#define NAND_BBT_VERIFY_SAMPLES	32
+
+/* OOB bytes holding the bad block marker, see nand_oob_is_bad() */
+#define NAND_BBT_OOB_SIZE	6
 
 /* configured NAND devices and NAND Flash command handler */
 struct nand_device *nand_devices;
@@ -223,12 +240,39 @@ COMMAND_HELPER(nand_command_get_device, unsigned name_index,
 	return ERROR_OK;
 }
 
+/* check the bad block marker in the OOB of a block's first page */
+static bool nand_oob_is_bad(struct nand_device *nand, const uint8_t *oob)
+{
+	if ((nand->device->options & NAND_BUSWIDTH_16) && ((oob[0] & oob[1]) != 0xff))
+		return true;
+
+	if ((nand->page_size == 512) && (oob[5] != 0xff))
+		return true;
+
+	if ((nand->page_size == 2048) && (oob[0] != 0xff))
+		return true;
+
+	return false;
+}
+
+static int nand_read_block_marker(struct nand_device *nand, int block, bool *bad)
+{
+	uint8_t oob[NAND_BBT_OOB_SIZE];
+	int retval;
+
+	retval = nand_read_page(nand, block * (nand->erase_size / nand->page_size),
+			NULL, 0, oob, sizeof(oob));
+	if (retval != ERROR_OK)
+		return retval;
+
+	*bad = nand_oob_is_bad(nand, oob);
+	return ERROR_OK;
+}
+
 int nand_build_bbt(struct nand_device *nand, int first, int last)
 {
-	uint32_t page;
-	int i;
-	int pages_per_block = (nand->erase_size / nand->page_size);
-	uint8_t oob[6];
+	uint8_t *oob = NULL;
+	int count;
 	int ret;
 
 	if ((first < 0) || (first >= nand->num_blocks))
@@ -237,26 +281,255 @@ int nand_build_bbt(struct nand_device *nand, int first, int last)
 	if ((last >= nand->num_blocks) || (last == -1))
 		last = nand->num_blocks - 1;
 
-	page = first * pages_per_block;
-	for (i = first; i <= last; i++) {
-		ret = nand_read_page(nand, page, NULL, 0, oob, 6);
-		if (ret != ERROR_OK)
+	count = last - first + 1;
+
+	/* let the controller read the markers of all blocks in one go */
+	ret = ERROR_NAND_NO_BUFFER;
+	if (nand->controller->read_block_oob) {
+		oob = malloc(count * NAND_BBT_OOB_SIZE);
+		if (oob == NULL) {
+			LOG_ERROR("no memory for OOB data");
+			return ERROR_FAIL;
+		}
+
+		ret = nand->controller->read_block_oob(nand, first, count,
+				oob, NAND_BBT_OOB_SIZE);
+		if (ret != ERROR_OK && ret != ERROR_NAND_NO_BUFFER) {
+			free(oob);
 			return ret;
+		}
+	}
+
+	for (int i = first; i <= last; i++) {
+		bool bad;
+
+		if (ret == ERROR_OK) {
+			bad = nand_oob_is_bad(nand, oob + (i - first) * NAND_BBT_OOB_SIZE);
+		} else {
+			int retval = nand_read_block_marker(nand, i, &bad);
+			if (retval != ERROR_OK) {
+				free(oob);
+				return retval;
+			}
+		}
 
-		if (((nand->device->options & NAND_BUSWIDTH_16) && ((oob[0] & oob[1]) != 0xff))
-				|| (((nand->page_size == 512) && (oob[5] != 0xff)) ||
-				((nand->page_size == 2048) && (oob[0] != 0xff)))) {
+		if (bad) {
 			LOG_WARNING("bad block: %i", i);
 			nand->blocks[i].is_bad = 1;
-		} else
+		} else if (!nand->blocks[i].failed)
 			nand->blocks[i].is_bad = 0;
+	}
+
+	free(oob);
+
+	if (nand->bbt_file)
+		nand_save_bbt(nand);
+
+	return ERROR_OK;
+}
+
+/* The table file holds a header identifying the device geometry and ID,
+ * followed by one NAND_BBT_* state byte per block. */
+static int nand_bbt_file_header(struct nand_device *nand, uint32_t *header)
+{
+	header[0] = nand->manufacturer->id;
+	header[1] = nand->device->id;
+	header[2] = nand->page_size;
+	header[3] = nand->erase_size;
+	header[4] = nand->num_blocks;
+	return 5;
+}
+
+/**
+ * Check a table read from the file against the device before using it:
+ * every block stored with its bad block marker set must still have it,
+ * and a sample of the good blocks must not.  That rejects a table of
+ * another chip with the same ID.  Blocks that failed in use are not
+ * checked, their marker was never written.
+ */
+static int nand_verify_bbt(struct nand_device *nand, const uint8_t *table)
+{
+	int step = nand->num_blocks / NAND_BBT_VERIFY_SAMPLES;
+	int retval;
+
+	if (step == 0)
+		step = 1;
+
+	for (int i = 0; i < nand->num_blocks; i++) {
+		bool sample = (table[i] == NAND_BBT_GOOD) && (i % step == 0);
+		bool bad;
 
-		page += pages_per_block;
+		if (table[i] != NAND_BBT_MARKED && !sample)
+			continue;
+
+		retval = nand_read_block_marker(nand, i, &bad);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (bad != (table[i] == NAND_BBT_MARKED)) {
+			LOG_INFO("block %i doesn't match the bad block table in %s, "
+				"ignoring it", i, nand->bbt_file);
+			return ERROR_FAIL;
+		}
 	}
 
 	return ERROR_OK;
 }
 
+/**
+ * Load the bad block table from the file configured with "nand bbt_file".
+ * The table is only accepted if it was written for a device with the same
+ * NAND ID and geometry, and its bad block markers match the device (see
+ * nand_verify_bbt()); otherwise the blocks stay unknown and the next
+ * nand_build_bbt() scans the device and rewrites the file.
+ */
+int nand_load_bbt(struct nand_device *nand)
+{
+	struct fileio *fileio;
+	char magic[NAND_BBT_FILE_MAGIC_LEN];
+	uint32_t header[5];
+	uint8_t *table = NULL;
+	size_t size_read;
+	int retval;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (!nand->bbt_file || access(nand->bbt_file, R_OK) != 0)
+		return ERROR_FAIL;
+
+	retval = fileio_open(&fileio, nand->bbt_file, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fileio_read(fileio, sizeof(magic), magic, &size_read);
+	if (retval != ERROR_OK || size_read != sizeof(magic)
+			|| memcmp(magic, NAND_BBT_FILE_MAGIC, sizeof(magic)) != 0) {
+		LOG_WARNING("%s is not a NAND bad block table", nand->bbt_file);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	int num = nand_bbt_file_header(nand, header);
+	for (int i = 0; i < num; i++) {
+		uint32_t value;
+		retval = fileio_read_u32(fileio, &value);
+		if (retval != ERROR_OK)
+			goto done;
+		if (value != header[i]) {
+			LOG_INFO("bad block table in %s belongs to a different device, "
+				"ignoring it", nand->bbt_file);
+			retval = ERROR_FAIL;
+			goto done;
+		}
+	}
+
+	table = malloc(nand->num_blocks);
+	if (table == NULL) {
+		LOG_ERROR("no memory for bad block table");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	retval = fileio_read(fileio, nand->num_blocks, table, &size_read);
+	if (retval != ERROR_OK || size_read != (size_t)nand->num_blocks) {
+		LOG_WARNING("bad block table in %s is truncated", nand->bbt_file);
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	retval = nand_verify_bbt(nand, table);
+	if (retval != ERROR_OK)
+		goto done;
+
+	for (int i = 0; i < nand->num_blocks; i++) {
+		switch (table[i]) {
+		case NAND_BBT_GOOD:
+			nand->blocks[i].is_bad = 0;
+			break;
+		case NAND_BBT_MARKED:
+			nand->blocks[i].is_bad = 1;
+			break;
+		case NAND_BBT_FAILED:
+			nand->blocks[i].is_bad = 1;
+			nand->blocks[i].failed = 1;
+			break;
+		default:
+			nand->blocks[i].is_bad = -1;
+			break;
+		}
+		if (nand->blocks[i].is_bad == 1)
+			LOG_DEBUG("bad block: %i", i);
+	}
+
+	LOG_INFO("loaded bad block table from %s", nand->bbt_file);
+
+done:
+	free(table);
+	fileio_close(fileio);
+	return retval;
+}
+
+/**
+ * Store the bad block table in the file configured with "nand bbt_file".
+ * Blocks that have not been checked yet are stored as unknown.
+ */
+int nand_save_bbt(struct nand_device *nand)
+{
+	struct fileio *fileio;
+	uint32_t header[5];
+	uint8_t *table;
+	size_t size_written;
+	int retval;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (!nand->bbt_file)
+		return ERROR_FAIL;
+
+	table = malloc(nand->num_blocks);
+	if (table == NULL) {
+		LOG_ERROR("no memory for bad block table");
+		return ERROR_FAIL;
+	}
+	for (int i = 0; i < nand->num_blocks; i++) {
+		if (nand->blocks[i].is_bad == -1)
+			table[i] = NAND_BBT_UNKNOWN;
+		else if (nand->blocks[i].failed)
+			table[i] = NAND_BBT_FAILED;
+		else if (nand->blocks[i].is_bad)
+			table[i] = NAND_BBT_MARKED;
+		else
+			table[i] = NAND_BBT_GOOD;
+	}
+
+	retval = fileio_open(&fileio, nand->bbt_file, FILEIO_WRITE, FILEIO_BINARY);
+	if (retval != ERROR_OK) {
+		free(table);
+		return retval;
+	}
+
+	retval = fileio_write(fileio, NAND_BBT_FILE_MAGIC_LEN, NAND_BBT_FILE_MAGIC,
+			&size_written);
+
+	int num = nand_bbt_file_header(nand, header);
+	for (int i = 0; retval == ERROR_OK && i < num; i++)
+		retval = fileio_write_u32(fileio, header[i]);
+
+	if (retval == ERROR_OK)
+		retval = fileio_write(fileio, nand->num_blocks, table, &size_written);
+
+	if (retval == ERROR_OK)
+		LOG_DEBUG("saved bad block table to %s", nand->bbt_file);
+	else
+		LOG_ERROR("couldn't save bad block table to %s", nand->bbt_file);
+
+	fileio_close(fileio);
+	free(table);
+	return retval;
+}
+
 int nand_read_status(struct nand_device *nand, uint8_t *status)
 {
 	if (!nand->device)
@@ -505,8 +778,13 @@ int nand_probe(struct nand_device *nand)
 		nand->blocks[i].offset = i * nand->erase_size;
 		nand->blocks[i].is_erased = -1;
 		nand->blocks[i].is_bad = -1;
+		nand->blocks[i].failed = 0;
 	}
 
+	/* a persisted table saves the bad block scan later on */
+	if (nand->bbt_file)
+		nand_load_bbt(nand);
+
 	return ERROR_OK;
 }
 
@@ -515,6 +793,7 @@ int nand_erase(struct nand_device *nand, int first_block, int last_block)
 	int i;
 	uint32_t page;
 	uint8_t status;
+	bool new_bad = false;
 	int retval;
 
 	if (!nand->device)
@@ -582,12 +861,21 @@ int nand_erase(struct nand_device *nand, int first_block, int last_block)
 				(nand->blocks[i].is_bad == 1)
 				? "bad " : "",
 				i, status);
+			/* remember it, the bad block marker isn't updated */
+			if (nand->blocks[i].is_bad != 1) {
+				nand->blocks[i].is_bad = 1;
+				nand->blocks[i].failed = 1;
+				new_bad = true;
+			}
 			/* continue; other blocks might still be erasable */
 		}
 
 		nand->blocks[i].is_erased = 1;
 	}
 
+	if (new_bad && nand->bbt_file)
+		nand_save_bbt(nand);
+
 	return ERROR_OK;
 }
 
@@ -835,13 +1123,12 @@ int nand_write_data_page(struct nand_device *nand, uint8_t *data, uint32_t size)
 	return retval;
 }
 
-int nand_write_finish(struct nand_device *nand)
+/* wait for a page program started with NAND_CMD_PAGEPROG and check status */
+static int nand_write_wait(struct nand_device *nand)
 {
 	int retval;
 	uint8_t status;
 
-	nand->controller->command(nand, NAND_CMD_PAGEPROG);
-
 	retval = nand->controller->nand_ready ?
 		nand->controller->nand_ready(nand, 100) :
 		nand_poll_ready(nand, 100);
@@ -863,7 +1150,14 @@ int nand_write_finish(struct nand_device *nand)
 	return ERROR_OK;
 }
 
-int nand_write_page_raw(struct nand_device *nand, uint32_t page,
+int nand_write_finish(struct nand_device *nand)
+{
+	nand->controller->command(nand, NAND_CMD_PAGEPROG);
+
+	return nand_write_wait(nand);
+}
+
+static int nand_write_page_load(struct nand_device *nand, uint32_t page,
 	uint8_t *data, uint32_t data_size,
 	uint8_t *oob, uint32_t oob_size)
 {
@@ -889,5 +1183,117 @@ int nand_write_page_raw(struct nand_device *nand, uint32_t page,
 		}
 	}
 
+	return ERROR_OK;
+}
+
+int nand_write_page_raw(struct nand_device *nand, uint32_t page,
+	uint8_t *data, uint32_t data_size,
+	uint8_t *oob, uint32_t oob_size)
+{
+	int retval;
+
+	retval = nand_write_page_load(nand, page, data, data_size, oob, oob_size);
+	if (ERROR_OK != retval)
+		return retval;
+
 	return nand_write_finish(nand);
 }
+
+/**
+ * Start programming a page without waiting for the device to finish.
+ * The caller may do host side work (read the next page from a file,
+ * compute its ECC) while the NAND is busy, and must then call
+ * nand_write_page_finish() before issuing anything else to the device.
+ * Controllers with their own write_page() handler are split only if
+ * they provide write_page_start(); otherwise the page is written
+ * completely here and the finish call is a no-op.
+ */
+int nand_write_page_start(struct nand_device *nand, uint32_t page,
+	uint8_t *data, uint32_t data_size,
+	uint8_t *oob, uint32_t oob_size)
+{
+	uint32_t block;
+	int retval;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (!nand->use_raw && nand->controller->write_page != NULL
+			&& nand->controller->write_page_start == NULL)
+		return nand_write_page(nand, page, data, data_size, oob, oob_size);
+
+	block = page / (nand->erase_size / nand->page_size);
+	if (nand->blocks[block].is_erased == 1)
+		nand->blocks[block].is_erased = 0;
+
+	if (!nand->use_raw && nand->controller->write_page != NULL) {
+		retval = nand->controller->write_page_start(nand, page,
+				data, data_size, oob, oob_size);
+		if (ERROR_OK != retval)
+			return retval;
+	} else {
+		retval = nand_write_page_load(nand, page, data, data_size, oob, oob_size);
+		if (ERROR_OK != retval)
+			return retval;
+
+		nand->controller->command(nand, NAND_CMD_PAGEPROG);
+	}
+	nand->write_pending = true;
+
+	return ERROR_OK;
+}
+
+/** Complete a page program started with nand_write_page_start(). */
+int nand_write_page_finish(struct nand_device *nand)
+{
+	if (!nand->write_pending)
+		return ERROR_OK;
+
+	nand->write_pending = false;
+	if (!nand->use_raw && nand->controller->write_page_finish != NULL)
+		return nand->controller->write_page_finish(nand);
+
+	return nand_write_wait(nand);
+}
+
+/**
+ * Write a series of pages through the controller's write_pages() handler.
+ * Returns ERROR_NAND_NO_BUFFER if the controller can't do that, in which
+ * case nothing was written.
+ */
+int nand_write_pages(struct nand_device *nand, uint32_t page, int count,
+	uint8_t *data, uint32_t page_bytes)
+{
+	uint32_t pages_per_block;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (nand->controller->write_pages == NULL)
+		return ERROR_NAND_NO_BUFFER;
+
+	pages_per_block = nand->erase_size / nand->page_size;
+	for (uint32_t block = page / pages_per_block;
+			block <= (page + count - 1) / pages_per_block; block++) {
+		if (nand->blocks[block].is_erased == 1)
+			nand->blocks[block].is_erased = 0;
+	}
+
+	return nand->controller->write_pages(nand, page, count, data, page_bytes);
+}
+
+/**
+ * Read a series of pages through the controller's read_pages() handler.
+ * Returns ERROR_NAND_NO_BUFFER if the controller can't do that.
+ */
+int nand_read_pages(struct nand_device *nand, uint32_t page, int count,
+	uint8_t *data, uint32_t page_bytes)
+{
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+
+	if (nand->controller->read_pages == NULL)
+		return ERROR_NAND_NO_BUFFER;
+
+	return nand->controller->read_pages(nand, page, count, data, page_bytes);
+}
@@ -41,6 +41,9 @@ struct nand_block {
 
 	/** True if the block is bad. */
 	int is_bad;
+
+	/** True if the block failed to erase; is_bad is set as well. */
+	int failed;
 };
 
 struct nand_oobfree {
@@ -69,6 +72,10 @@ struct nand_device {
 	bool use_raw;
 	int num_blocks;
 	struct nand_block *blocks;
+	/** Host file used to persist the bad block table, or NULL. */
+	char *bbt_file;
+	/** A page program was started and not yet waited for. */
+	bool write_pending;
 	struct nand_device *next;
 };
 
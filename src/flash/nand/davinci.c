@@ -51,6 +51,9 @@ struct davinci_nand {
 	/* write acceleration */
 	struct arm_nand_data io;
 
+	/* leave the chip programming after PAGEPROG (write_page_start) */
+	bool defer_wait;
+
 	/* page i/o for the relevant flavor of hardware ECC */
 	int (*read_page)(struct nand_device *nand, uint32_t page,
 			 uint8_t *data, uint32_t data_size, uint8_t *oob, uint32_t oob_size);
@@ -355,19 +358,10 @@ static int davinci_seek_column(struct nand_device *nand, uint16_t column)
 	return ERROR_OK;
 }
 
-static int davinci_writepage_tail(struct nand_device *nand,
-	uint8_t *oob, uint32_t oob_size)
+static int davinci_writepage_wait(struct nand_device *nand)
 {
-	struct davinci_nand *info = nand->controller_priv;
-	struct target *target = nand->target;
 	uint8_t status;
 
-	if (oob_size)
-		davinci_write_block_data(nand, oob, oob_size);
-
-	/* non-cachemode page program */
-	target_write_u8(target, info->cmd, NAND_CMD_PAGEPROG);
-
 	if (!davinci_nand_ready(nand, 100))
 		return ERROR_NAND_OPERATION_TIMEOUT;
 
@@ -384,6 +378,25 @@ static int davinci_writepage_tail(struct nand_device *nand,
 	return ERROR_OK;
 }
 
+static int davinci_writepage_tail(struct nand_device *nand,
+	uint8_t *oob, uint32_t oob_size)
+{
+	struct davinci_nand *info = nand->controller_priv;
+	struct target *target = nand->target;
+
+	if (oob_size)
+		davinci_write_block_data(nand, oob, oob_size);
+
+	/* non-cachemode page program */
+	target_write_u8(target, info->cmd, NAND_CMD_PAGEPROG);
+
+	/* davinci_write_page_finish() waits for the chip */
+	if (info->defer_wait)
+		return ERROR_OK;
+
+	return davinci_writepage_wait(nand);
+}
+
 /*
  * All DaVinci family chips support 1-bit ECC on a per-chipselect basis.
  */
@@ -671,6 +684,81 @@ static int davinci_read_page_ecc4infix(struct nand_device *nand, uint32_t page,
 	return ERROR_OK;
 }
 
+/*
+ * Like davinci_write_page(), but return once PAGEPROG is issued so the
+ * host can prepare the next page while this one is being programmed.
+ */
+static int davinci_write_page_start(struct nand_device *nand, uint32_t page,
+	uint8_t *data, uint32_t data_size, uint8_t *oob, uint32_t oob_size)
+{
+	struct davinci_nand *info = nand->controller_priv;
+	int status;
+
+	info->defer_wait = true;
+	status = davinci_write_page(nand, page, data, data_size, oob, oob_size);
+	info->defer_wait = false;
+
+	return status;
+}
+
+static int davinci_write_page_finish(struct nand_device *nand)
+{
+	if (!halted(nand->target, "write_page_finish"))
+		return ERROR_NAND_OPERATION_FAILED;
+
+	return davinci_writepage_wait(nand);
+}
+
+static int davinci_read_block_oob(struct nand_device *nand, int first_block,
+	int count, uint8_t *oob, uint32_t oob_size)
+{
+	struct davinci_nand *info = nand->controller_priv;
+
+	if (!nand->device)
+		return ERROR_NAND_DEVICE_NOT_PROBED;
+	if (!halted(nand->target, "read_block_oob"))
+		return ERROR_NAND_OPERATION_FAILED;
+
+	/* keep the copy area big enough for page sized read/write chunks */
+	info->io.chunk_size = nand->page_size;
+
+	return arm_nand_read_oob(&info->io, nand, first_block, count,
+			oob, oob_size);
+}
+
+static int davinci_write_pages(struct nand_device *nand, uint32_t page,
+	int count, uint8_t *data, uint32_t page_bytes)
+{
+	struct davinci_nand *info = nand->controller_priv;
+
+	/* the target side loop doesn't drive the ECC engine */
+	if (!nand->use_raw)
+		return ERROR_NAND_NO_BUFFER;
+	if (!halted(nand->target, "write_pages"))
+		return ERROR_NAND_OPERATION_FAILED;
+
+	info->io.chunk_size = nand->page_size;
+
+	return arm_nand_write_pages(&info->io, nand, page, count,
+			data, page_bytes);
+}
+
+static int davinci_read_pages(struct nand_device *nand, uint32_t page,
+	int count, uint8_t *data, uint32_t page_bytes)
+{
+	struct davinci_nand *info = nand->controller_priv;
+
+	if (!nand->use_raw && info->read_page != nand_read_page_raw)
+		return ERROR_NAND_NO_BUFFER;
+	if (!halted(nand->target, "read_pages"))
+		return ERROR_NAND_OPERATION_FAILED;
+
+	info->io.chunk_size = nand->page_size;
+
+	return arm_nand_read_pages(&info->io, nand, page, count,
+			data, page_bytes);
+}
+
 NAND_DEVICE_COMMAND_HANDLER(davinci_nand_device_command)
 {
 	struct davinci_nand *info;
@@ -745,6 +833,10 @@ NAND_DEVICE_COMMAND_HANDLER(davinci_nand_device_command)
 
 	info->io.target = nand->target;
 	info->io.data = info->data;
+	info->io.cmd = info->cmd;
+	info->io.addr = info->addr;
+	info->io.ready = info->aemif + NANDFSR;
+	info->io.ready_mask = 0x01;
 	info->io.op = ARM_NAND_NONE;
 
 	/* NOTE:  for now we don't do any error correction on read.
@@ -786,7 +878,12 @@ struct nand_flash_controller davinci_nand_controller = {
 	.write_data             = davinci_write_data,
 	.read_data              = davinci_read_data,
 	.write_page             = davinci_write_page,
+	.write_page_start       = davinci_write_page_start,
+	.write_page_finish      = davinci_write_page_finish,
 	.read_page              = davinci_read_page,
+	.read_block_oob         = davinci_read_block_oob,
+	.write_pages            = davinci_write_pages,
+	.read_pages             = davinci_read_pages,
 	.write_block_data       = davinci_write_block_data,
 	.read_block_data        = davinci_read_block_data,
 	.nand_ready             = davinci_nand_ready,
@@ -71,10 +71,44 @@ struct nand_flash_controller {
 	int (*write_page)(struct nand_device *nand, uint32_t page, uint8_t *data,
 			  uint32_t data_size, uint8_t *oob, uint32_t oob_size);
 
+	/**
+	 * Start writing a page to the NAND device, returning while the device
+	 * is still programming it.  Optional; a driver providing it must also
+	 * provide write_page_finish().
+	 */
+	int (*write_page_start)(struct nand_device *nand, uint32_t page, uint8_t *data,
+			uint32_t data_size, uint8_t *oob, uint32_t oob_size);
+
+	/** Wait for a page started with write_page_start() and check its status. */
+	int (*write_page_finish)(struct nand_device *nand);
+
 	/** Read a page from the NAND device. */
 	int (*read_page)(struct nand_device *nand, uint32_t page, uint8_t *data, uint32_t data_size,
 			 uint8_t *oob, uint32_t oob_size);
 
+	/**
+	 * Read the first @a oob_size OOB bytes of the first page of @a count
+	 * blocks starting at @a first_block into @a oob, to build the bad
+	 * block table.  Optional; returning ERROR_NAND_NO_BUFFER makes the
+	 * caller read the pages one by one.
+	 */
+	int (*read_block_oob)(struct nand_device *nand, int first_block, int count,
+			uint8_t *oob, uint32_t oob_size);
+
+	/**
+	 * Write @a count consecutive pages starting at @a page, @a page_bytes
+	 * bytes each (page data followed by OOB data) as found in @a data,
+	 * using code running on the target.  Optional; returning
+	 * ERROR_NAND_NO_BUFFER, e.g. when the page needs hardware ECC, makes
+	 * the caller write the pages one by one.
+	 */
+	int (*write_pages)(struct nand_device *nand, uint32_t page, int count,
+			uint8_t *data, uint32_t page_bytes);
+
+	/** Read counterpart of write_pages(), with the same layout of @a data. */
+	int (*read_pages)(struct nand_device *nand, uint32_t page, int count,
+			uint8_t *data, uint32_t page_bytes);
+
 	/** Check if the NAND device is ready for more instructions with timeout. */
 	int (*nand_ready)(struct nand_device *nand, int timeout);
 };
@@ -31,8 +31,20 @@ int nand_read_page(struct nand_device *nand, uint32_t page,
 		uint8_t *data, uint32_t data_size,
 		uint8_t *oob, uint32_t oob_size);
 
+int nand_write_page_start(struct nand_device *nand,
+		uint32_t page, uint8_t *data, uint32_t data_size,
+		uint8_t *oob, uint32_t oob_size);
+int nand_write_page_finish(struct nand_device *nand);
+
+int nand_write_pages(struct nand_device *nand, uint32_t page, int count,
+		uint8_t *data, uint32_t page_bytes);
+int nand_read_pages(struct nand_device *nand, uint32_t page, int count,
+		uint8_t *data, uint32_t page_bytes);
+
 int nand_probe(struct nand_device *nand);
 int nand_erase(struct nand_device *nand, int first_block, int last_block);
 int nand_build_bbt(struct nand_device *nand, int first, int last);
+int nand_load_bbt(struct nand_device *nand);
+int nand_save_bbt(struct nand_device *nand);
 
 #endif /* OPENOCD_FLASH_NAND_IMP_H */
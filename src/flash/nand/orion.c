@@ -105,6 +105,30 @@ static int orion_nand_fast_block_write(struct nand_device *nand, uint8_t *data,
 	return retval;
 }
 
+static int orion_nand_write_pages(struct nand_device *nand, uint32_t page,
+	int count, uint8_t *data, uint32_t page_bytes)
+{
+	struct orion_nand_controller *hw = nand->controller_priv;
+	struct target *target = nand->target;
+
+	CHECK_HALTED;
+	hw->io.chunk_size = nand->page_size;
+
+	return arm_nand_write_pages(&hw->io, nand, page, count, data, page_bytes);
+}
+
+static int orion_nand_read_pages(struct nand_device *nand, uint32_t page,
+	int count, uint8_t *data, uint32_t page_bytes)
+{
+	struct orion_nand_controller *hw = nand->controller_priv;
+	struct target *target = nand->target;
+
+	CHECK_HALTED;
+	hw->io.chunk_size = nand->page_size;
+
+	return arm_nand_read_pages(&hw->io, nand, page, count, data, page_bytes);
+}
+
 static int orion_nand_reset(struct nand_device *nand)
 {
 	return orion_nand_command(nand, NAND_CMD_RESET);
@@ -137,6 +161,8 @@ NAND_DEVICE_COMMAND_HANDLER(orion_nand_device_command)
 
 	hw->io.target = nand->target;
 	hw->io.data = hw->data;
+	hw->io.cmd = hw->cmd;
+	hw->io.addr = hw->addr;
 	hw->io.op = ARM_NAND_NONE;
 
 	return ERROR_OK;
@@ -155,6 +181,8 @@ struct nand_flash_controller orion_nand_controller = {
 	.read_data = orion_nand_read,
 	.write_data = orion_nand_write,
 	.write_block_data = orion_nand_fast_block_write,
+	.write_pages = orion_nand_write_pages,
+	.read_pages = orion_nand_read_pages,
 	.reset = orion_nand_reset,
 	.nand_device_command = orion_nand_device_command,
 	.init = orion_nand_init,
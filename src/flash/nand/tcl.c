@@ -118,6 +118,8 @@ COMMAND_HANDLER(handle_nand_info_command)
 
 		if (p->blocks[j].is_bad == 0)
 			bad_state = "";
+		else if (p->blocks[j].failed)
+			bad_state = " (failed to erase)";
 		else if (p->blocks[j].is_bad == 1)
 			bad_state = " (marked bad)";
 		else
@@ -240,6 +242,70 @@ COMMAND_HANDLER(handle_nand_check_bad_blocks_command)
 	return retval;
 }
 
+/* Pages the host collects for one nand_write_pages()/nand_read_pages() call. */
+#define NAND_BATCH_PAGES	32
+
+/**
+ * Write the file in batches of pages programmed by code on the target.
+ * If the controller turns a batch down, its pages are written one by one
+ * and ERROR_NAND_NO_BUFFER tells the caller to go on with the rest.
+ * File read errors are returned as ERROR_FILEIO_OPERATION_FAILED.
+ */
+static int nand_write_batches(struct nand_device *nand,
+	struct nand_fileio_state *s, unsigned *pages, unsigned *batches)
+{
+	uint32_t unit = s->page_size + (s->oob ? s->oob_size : 0);
+	uint8_t *buf;
+	int retval = ERROR_OK;
+
+	buf = malloc(NAND_BATCH_PAGES * unit);
+	if (!buf)
+		return ERROR_NAND_NO_BUFFER;
+
+	while (s->size > 0) {
+		uint32_t page = s->address / nand->page_size;
+		int n;
+
+		for (n = 0; n < NAND_BATCH_PAGES && s->size > 0; n++) {
+			int bytes_read = nand_fileio_read(nand, s);
+			if (bytes_read <= 0) {
+				retval = ERROR_FILEIO_OPERATION_FAILED;
+				goto out;
+			}
+			s->size -= bytes_read;
+
+			memcpy(buf + n * unit, s->page, s->page_size);
+			if (s->oob)
+				memcpy(buf + n * unit + s->page_size, s->oob, s->oob_size);
+		}
+
+		retval = nand_write_pages(nand, page, n, buf, unit);
+		if (retval == ERROR_NAND_NO_BUFFER) {
+			for (int i = 0; i < n; i++) {
+				uint8_t *data = buf + i * unit;
+
+				retval = nand_write_page(nand, page + i, data, s->page_size,
+						s->oob ? data + s->page_size : NULL, s->oob_size);
+				if (retval != ERROR_OK)
+					goto out;
+				s->address += nand->page_size;
+			}
+			retval = ERROR_NAND_NO_BUFFER;
+			goto out;
+		}
+		if (retval != ERROR_OK)
+			goto out;
+
+		s->address += n * nand->page_size;
+		*pages += n;
+		(*batches)++;
+	}
+
+out:
+	free(buf);
+	return retval;
+}
+
 COMMAND_HANDLER(handle_nand_write_command)
 {
 	struct nand_device *nand = NULL;
@@ -249,35 +315,106 @@ COMMAND_HANDLER(handle_nand_write_command)
 	if (ERROR_OK != retval)
 		return retval;
 
+	/* Double buffer the page data: while the device programs one page,
+	 * the next one is read from the file and its ECC is computed. */
+	uint8_t *next_page = NULL;
+	uint8_t *next_oob = NULL;
+	if (s.page) {
+		next_page = malloc(s.page_size);
+		if (!next_page)
+			goto nomem;
+	}
+	if (s.oob) {
+		next_oob = malloc(s.oob_size);
+		if (!next_oob)
+			goto nomem;
+	}
+
 	uint32_t total_bytes = s.size;
+	unsigned pages = 0, batches = 0;
+
+	/* if the controller can, let code on the target program whole
+	 * batches of pages; anything it turns down takes the loop below */
+	if (s.page && nand->controller->write_pages) {
+		retval = nand_write_batches(nand, &s, &pages, &batches);
+		if (retval == ERROR_FILEIO_OPERATION_FAILED)
+			goto read_error;
+		if (retval != ERROR_OK && retval != ERROR_NAND_NO_BUFFER)
+			goto write_error;
+	}
+
+	int bytes_read = 0;
+	if (s.size > 0) {
+		bytes_read = nand_fileio_read(nand, &s);
+		if (bytes_read <= 0)
+			goto read_error;
+	}
+
 	while (s.size > 0) {
-		int bytes_read = nand_fileio_read(nand, &s);
-		if (bytes_read <= 0) {
-			command_print(CMD, "error while reading file");
-			nand_fileio_cleanup(&s);
-			return ERROR_FAIL;
-		}
 		s.size -= bytes_read;
 
-		retval = nand_write_page(nand, s.address / nand->page_size,
+		retval = nand_write_page_start(nand, s.address / nand->page_size,
 				s.page, s.page_size, s.oob, s.oob_size);
-		if (ERROR_OK != retval) {
-			command_print(CMD, "failed writing file %s "
-				"to NAND flash %s at offset 0x%8.8" PRIx32,
-				CMD_ARGV[1], CMD_ARGV[0], s.address);
-			nand_fileio_cleanup(&s);
-			return retval;
+		if (ERROR_OK != retval)
+			goto write_error;
+
+		/* swap buffers and prepare the next page while the NAND is busy */
+		uint8_t *tmp = s.page;
+		s.page = next_page;
+		next_page = tmp;
+		tmp = s.oob;
+		s.oob = next_oob;
+		next_oob = tmp;
+
+		if (s.size > 0) {
+			bytes_read = nand_fileio_read(nand, &s);
+			if (bytes_read <= 0) {
+				nand_write_page_finish(nand);
+				goto read_error;
+			}
 		}
+
+		retval = nand_write_page_finish(nand);
+		if (ERROR_OK != retval)
+			goto write_error;
+
 		s.address += s.page_size;
 	}
 
+	free(next_page);
+	free(next_oob);
+
 	if (nand_fileio_finish(&s) == ERROR_OK) {
 		command_print(CMD, "wrote file %s to NAND flash %s up to "
 			"offset 0x%8.8" PRIx32 " in %fs (%0.3f KiB/s)",
 			CMD_ARGV[1], CMD_ARGV[0], s.address, duration_elapsed(&s.bench),
 			duration_kbps(&s.bench, total_bytes));
+		if (batches)
+			command_print(CMD, "%u pages programmed by the target "
+				"in %u batches", pages, batches);
 	}
 	return ERROR_OK;
+
+nomem:
+	LOG_ERROR("Out of memory");
+	retval = ERROR_FAIL;
+	goto cleanup;
+
+read_error:
+	command_print(CMD, "error while reading file");
+	retval = ERROR_FAIL;
+	goto cleanup;
+
+write_error:
+	command_print(CMD, "failed writing file %s "
+		"to NAND flash %s at offset 0x%8.8" PRIx32,
+		CMD_ARGV[1], CMD_ARGV[0], s.address);
+
+cleanup:
+	free(next_page);
+	free(next_oob);
+	nand_fileio_cleanup(&s);
+	return retval;
 }
 
 COMMAND_HANDLER(handle_nand_verify_command)
@@ -349,6 +486,38 @@ COMMAND_HANDLER(handle_nand_dump_command)
 	if (ERROR_OK != retval)
 		return retval;
 
+	/* if the controller can, let code on the target read whole batches
+	 * of pages; the file gets the same page data + OOB layout */
+	unsigned pages = 0, batches = 0;
+	if (s.page && nand->controller->read_pages) {
+		uint32_t unit = s.page_size + (s.oob ? s.oob_size : 0);
+		uint8_t *buf = malloc(NAND_BATCH_PAGES * unit);
+
+		while (buf && s.size > 0) {
+			size_t size_written;
+			int n = MIN(NAND_BATCH_PAGES, DIV_ROUND_UP(s.size, nand->page_size));
+
+			retval = nand_read_pages(nand, s.address / nand->page_size,
+					n, buf, unit);
+			if (retval == ERROR_NAND_NO_BUFFER)
+				break;
+			if (ERROR_OK != retval) {
+				command_print(CMD, "reading NAND flash page failed");
+				free(buf);
+				nand_fileio_cleanup(&s);
+				return retval;
+			}
+
+			fileio_write(s.fileio, n * unit, buf, &size_written);
+
+			s.size -= MIN(s.size, (uint32_t) (n * nand->page_size));
+			s.address += n * nand->page_size;
+			pages += n;
+			batches++;
+		}
+		free(buf);
+	}
+
 	while (s.size > 0) {
 		size_t size_written;
 		retval = nand_read_page(nand, s.address / nand->page_size,
@@ -377,6 +546,9 @@ COMMAND_HANDLER(handle_nand_dump_command)
 		command_print(CMD, "dumped %zu bytes in %fs (%0.3f KiB/s)",
 			filesize, duration_elapsed(&s.bench),
 			duration_kbps(&s.bench, filesize));
+		if (batches)
+			command_print(CMD, "%u pages read by the target "
+				"in %u batches", pages, batches);
 	}
 	return ERROR_OK;
 }
@@ -405,6 +577,37 @@ COMMAND_HANDLER(handle_nand_raw_access_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_nand_bbt_file_command)
+{
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct nand_device *p;
+	int retval = CALL_COMMAND_HANDLER(nand_command_get_device, 0, &p);
+	if (ERROR_OK != retval)
+		return retval;
+
+	if (CMD_ARGC == 2) {
+		free(p->bbt_file);
+		p->bbt_file = NULL;
+		if (strcmp(CMD_ARGV[1], "none") != 0) {
+			p->bbt_file = strdup(CMD_ARGV[1]);
+			if (p->bbt_file == NULL) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			/* pick up an existing table if the device is already probed */
+			if (p->device)
+				nand_load_bbt(p);
+		}
+	}
+
+	command_print(CMD, "bad block table file: %s",
+		p->bbt_file ? p->bbt_file : "none");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration nand_exec_command_handlers[] = {
 	{
 		.name = "list",
@@ -549,6 +752,8 @@ static COMMAND_HELPER(create_nand_device, const char *bank_name,
 	c->address_cycles = 0;
 	c->page_size = 0;
 	c->use_raw = false;
+	c->bbt_file = NULL;
+	c->write_pending = false;
 	c->next = NULL;
 
 	retval = CALL_COMMAND_HANDLER(controller->nand_device_command, c);
@@ -609,6 +814,14 @@ static const struct command_registration nand_config_command_handlers[] = {
 		.help = "initialize NAND devices",
 		.usage = ""
 	},
+	{
+		.name = "bbt_file",
+		.handler = &handle_nand_bbt_file_command,
+		.mode = COMMAND_ANY,
+		.help = "set or show the host file used to persist the "
+			"bad block table",
+		.usage = "bank_id [filename|'none']",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -127,6 +127,17 @@ int flash_driver_read(struct flash_bank *bank,
 	return retval;
 }
 
+int flash_driver_verify(struct flash_bank *bank,
+	const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	if (bank->driver->verify == NULL)
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+
+	LOG_DEBUG("call flash_driver_verify()");
+
+	return bank->driver->verify(bank, buffer, offset, count);
+}
+
 int default_flash_read(struct flash_bank *bank,
 	uint8_t *buffer, uint32_t offset, uint32_t count)
 {
@@ -153,6 +153,21 @@ struct flash_driver {
 	 int (*read)(struct flash_bank *bank,
 			uint8_t *buffer, uint32_t offset, uint32_t count);
 
+	/**
+	 * Check flash contents against a host buffer without reading them
+	 * back, e.g. by running a checksum on the target. If not provided,
+	 * or if it does not return ERROR_OK, callers fall back to reading
+	 * the data and comparing it on the host.
+	 *
+	 * @param bank The bank to verify.
+	 * @param buffer The data bytes expected in flash.
+	 * @param offset The offset into the chip to verify.
+	 * @param count The number of bytes to verify.
+	 * @returns ERROR_OK if the contents match; otherwise, an error code.
+	 */
+	int (*verify)(struct flash_bank *bank,
+			const uint8_t *buffer, uint32_t offset, uint32_t count);
+
 	/**
 	 * Probe to determine what kind of flash is present.
 	 * This is invoked by the "probe" script command.
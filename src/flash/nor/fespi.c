@@ -39,9 +39,11 @@
 
 #include "imp.h"
 #include "spi.h"
+#include "sfdp.h"
 #include <jtag/jtag.h>
 #include <helper/time_support.h>
 #include <target/algorithm.h>
+#include <target/image.h>
 #include "target/riscv/riscv.h"
 
 /* Register offsets */
@@ -681,6 +683,107 @@ err:
 	return retval;
 }
 
+/* Set up memory-mapped reads with the fastest read the controller can issue
+ * on its own. A dual or quad read set up by the boot code is kept, since
+ * enabling quad mode in the flash is vendor specific; a plain read is
+ * upgraded to fast read. The previous setting is returned in *ffmt_saved
+ * so it can be restored with fespi_restore_mmap_read().
+ */
+static int fespi_setup_mmap_read(struct flash_bank *bank, uint32_t *ffmt_saved)
+{
+	uint32_t ffmt;
+
+	if (fespi_read_reg(bank, &ffmt, FESPI_REG_FFMT) != ERROR_OK)
+		return ERROR_FAIL;
+	*ffmt_saved = ffmt;
+
+	if ((ffmt & FESPI_INSN_DATA_PROTO(0x3)) == FESPI_INSN_DATA_PROTO(FESPI_PROTO_S)) {
+		bool addr4b = bank->size > 0x1000000;
+		ffmt = FESPI_INSN_CMD_EN |
+			FESPI_INSN_ADDR_LEN(addr4b ? 4 : 3) |
+			FESPI_INSN_PAD_CNT(8) |
+			FESPI_INSN_CMD_PROTO(FESPI_PROTO_S) |
+			FESPI_INSN_ADDR_PROTO(FESPI_PROTO_S) |
+			FESPI_INSN_DATA_PROTO(FESPI_PROTO_S) |
+			/* 0x0c is fast read with a 4-byte address */
+			FESPI_INSN_CMD_CODE(addr4b ? 0x0c : SPIFLASH_FAST_READ) |
+			FESPI_INSN_PAD_CODE(0x00);
+		if (fespi_write_reg(bank, FESPI_REG_FFMT, ffmt) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	return fespi_enable_hw_mode(bank);
+}
+
+static int fespi_restore_mmap_read(struct flash_bank *bank, uint32_t ffmt)
+{
+	return fespi_write_reg(bank, FESPI_REG_FFMT, ffmt);
+}
+
+static int fespi_read(struct flash_bank *bank, uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+	uint32_t ffmt;
+
+	if (!(fespi_info->probed)) {
+		LOG_ERROR("Flash bank not probed");
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	int retval = fespi_setup_mmap_read(bank, &ffmt);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_read_buffer(bank->target, bank->base + offset, count, buffer);
+
+	if (fespi_restore_mmap_read(bank, ffmt) != ERROR_OK)
+		return ERROR_FAIL;
+
+	return retval;
+}
+
+/* Compare a CRC computed by the target over the mapped flash with one of
+ * the host buffer, instead of reading the flash back over JTAG. */
+static int fespi_verify(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+	uint32_t ffmt, host_crc, target_crc;
+
+	if (!(fespi_info->probed)) {
+		LOG_ERROR("Flash bank not probed");
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	if (bank->target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	int retval = image_calculate_checksum((uint8_t *) buffer, count, &host_crc);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fespi_setup_mmap_read(bank, &ffmt);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = target_checksum_memory(bank->target, bank->base + offset, count,
+			&target_crc);
+
+	if (fespi_restore_mmap_read(bank, ffmt) != ERROR_OK)
+		return ERROR_FAIL;
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (host_crc != target_crc) {
+		LOG_DEBUG("checksum mismatch: target 0x%08" PRIx32 ", host 0x%08" PRIx32,
+				target_crc, host_crc);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 /* Return ID of flash device */
 /* On exit, SW mode is kept */
 static int fespi_read_flash_id(struct flash_bank *bank, uint32_t *id)
@@ -735,6 +838,43 @@ static int fespi_read_flash_id(struct flash_bank *bank, uint32_t *id)
 	return ERROR_OK;
 }
 
+/* Read words of the SFDP area; SW mode must be active */
+static int fespi_read_sfdp_block(struct flash_bank *bank, uint32_t addr,
+		uint32_t words, uint32_t *buffer)
+{
+	fespi_set_dir(bank, FESPI_DIR_RX);
+
+	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_HOLD) != ERROR_OK)
+		return ERROR_FAIL;
+
+	/* command, 3-byte address and one dummy byte, responses discarded */
+	fespi_tx(bank, SPIFLASH_READ_SFDP);
+	fespi_tx(bank, addr >> 16);
+	fespi_tx(bank, addr >> 8);
+	fespi_tx(bank, addr);
+	fespi_tx(bank, 0);
+	for (int i = 0; i < 5; i++) {
+		if (fespi_rx(bank, NULL) != ERROR_OK)
+			return ERROR_FAIL;
+	}
+
+	for (uint32_t i = 0; i < words; i++) {
+		buffer[i] = 0;
+		for (int j = 0; j < 4; j++) {
+			uint8_t rx;
+			fespi_tx(bank, 0);
+			if (fespi_rx(bank, &rx) != ERROR_OK)
+				return ERROR_FAIL;
+			buffer[i] |= (uint32_t) rx << (8 * j);
+		}
+	}
+
+	if (fespi_write_reg(bank, FESPI_REG_CSMODE, FESPI_CSMODE_AUTO) != ERROR_OK)
+		return ERROR_FAIL;
+
+	return fespi_set_dir(bank, FESPI_DIR_TX);
+}
+
 static int fespi_probe(struct flash_bank *bank)
 {
 	struct target *target = bank->target;
@@ -782,18 +922,25 @@ static int fespi_probe(struct flash_bank *bank)
 
 	retval = fespi_read_flash_id(bank, &id);
 
+	fespi_info->dev = NULL;
+	if (retval == ERROR_OK) {
+		for (const struct flash_device *p = flash_devices; p->name ; p++)
+			if (p->device_id == id) {
+				fespi_info->dev = p;
+				break;
+			}
+
+		/* Not in the table: describe it from its SFDP tables, still in SW mode */
+		if (!fespi_info->dev &&
+				spi_sfdp(bank, id, fespi_read_sfdp_block, &fespi_info->dev) != ERROR_OK)
+			fespi_info->dev = NULL;
+	}
+
 	if (fespi_enable_hw_mode(bank) != ERROR_OK)
 		return ERROR_FAIL;
 	if (retval != ERROR_OK)
 		return retval;
 
-	fespi_info->dev = NULL;
-	for (const struct flash_device *p = flash_devices; p->name ; p++)
-		if (p->device_id == id) {
-			fespi_info->dev = p;
-			break;
-		}
-
 	if (!fespi_info->dev) {
 		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
 		return ERROR_FAIL;
@@ -869,7 +1016,8 @@ const struct flash_driver fespi_flash = {
 	.erase = fespi_erase,
 	.protect = fespi_protect,
 	.write = fespi_write,
-	.read = default_flash_read,
+	.read = fespi_read,
+	.verify = fespi_verify,
 	.probe = fespi_probe,
 	.auto_probe = fespi_auto_probe,
 	.erase_check = default_flash_blank_check,
@@ -22,16 +22,25 @@
 #include "imp.h"
 #include <jtag/jtag.h>
 #include <flash/nor/spi.h>
+#include <flash/nor/sfdp.h>
 #include <helper/time_support.h>
 
 #define JTAGSPI_MAX_TIMEOUT 3000
+/* status reads queued behind each page program / per polling flush */
+#define JTAGSPI_DEF_POLL_COUNT 16
+#define JTAGSPI_MAX_POLL_COUNT 1024
 
 
 struct jtagspi_flash_bank {
 	struct jtag_tap *tap;
 	const struct flash_device *dev;
 	int probed;
+	bool addr4b;
+	uint8_t read_cmd;
+	uint8_t pprog_cmd;
+	uint8_t erase_cmd;
 	uint32_t ir;
+	unsigned int poll_count;
 };
 
 FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
@@ -50,6 +59,8 @@ FLASH_BANK_COMMAND_HANDLER(jtagspi_flash_bank_command)
 
 	info->tap = NULL;
 	info->probed = 0;
+	info->addr4b = false;
+	info->poll_count = JTAGSPI_DEF_POLL_COUNT;
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[6], info->ir);
 
 	return ERROR_OK;
@@ -75,17 +86,22 @@ static void flip_u8(uint8_t *in, uint8_t *out, int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+/* Queue one SPI transaction without executing the JTAG queue. Output data
+ * is copied into the queue, so "data" may be released once this returns.
+ * For reads (len < 0) "data" receives the raw, bit-reversed flash data and
+ * must stay valid until the queue has been executed; the caller then has to
+ * pass it through flip_u8(). */
+static int jtagspi_queue_cmd(struct flash_bank *bank, uint8_t cmd,
 		uint32_t *addr, uint8_t *data, int len)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
 	struct scan_field fields[6];
 	uint8_t marker = 1;
 	uint8_t xfer_bits_buf[4];
-	uint8_t addr_buf[3];
-	uint8_t *data_buf;
+	uint8_t addr_buf[4];
+	uint8_t *data_buf = NULL;
 	uint32_t xfer_bits;
-	int is_read, lenb, n;
+	int is_read, lenb, n, addr_bits;
 
 	/* LOG_DEBUG("cmd=0x%02x len=%i", cmd, len); */
 
@@ -100,10 +116,11 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	fields[n].in_value = NULL;
 	n++;
 
+	addr_bits = info->addr4b ? 32 : 24;
 	xfer_bits = 8 + len - 1;
 	/* cmd + read/write - 1 due to the counter implementation */
 	if (addr)
-		xfer_bits += 24;
+		xfer_bits += addr_bits;
 	h_u32_to_be(xfer_bits_buf, xfer_bits);
 	flip_u8(xfer_bits_buf, xfer_bits_buf, 4);
 	fields[n].num_bits = 32;
@@ -118,21 +135,19 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	n++;
 
 	if (addr) {
-		h_u24_to_be(addr_buf, *addr);
-		flip_u8(addr_buf, addr_buf, 3);
-		fields[n].num_bits = 24;
+		if (info->addr4b)
+			h_u32_to_be(addr_buf, *addr);
+		else
+			h_u24_to_be(addr_buf, *addr);
+		flip_u8(addr_buf, addr_buf, addr_bits / 8);
+		fields[n].num_bits = addr_bits;
 		fields[n].out_value = addr_buf;
 		fields[n].in_value = NULL;
 		n++;
 	}
 
 	lenb = DIV_ROUND_UP(len, 8);
-	data_buf = malloc(lenb);
 	if (lenb > 0) {
-		if (data_buf == NULL) {
-			LOG_ERROR("no memory for spi buffer");
-			return ERROR_FAIL;
-		}
 		if (is_read) {
 			fields[n].num_bits = jtag_tap_count_enabled();
 			fields[n].out_value = NULL;
@@ -140,8 +155,13 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 			n++;
 
 			fields[n].out_value = NULL;
-			fields[n].in_value = data_buf;
+			fields[n].in_value = data;
 		} else {
+			data_buf = malloc(lenb);
+			if (data_buf == NULL) {
+				LOG_ERROR("no memory for spi buffer");
+				return ERROR_FAIL;
+			}
 			flip_u8(data, data_buf, lenb);
 			fields[n].out_value = data_buf;
 			fields[n].in_value = NULL;
@@ -153,14 +173,75 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	jtagspi_set_ir(bank);
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	int retval = jtag_execute_queue();
 
-	if (is_read)
-		flip_u8(data_buf, data, lenb);
 	free(data_buf);
+	return ERROR_OK;
+}
+
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		uint32_t *addr, uint8_t *data, int len)
+{
+	int retval = jtagspi_queue_cmd(bank, cmd, addr, data, len);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = jtag_execute_queue();
+
+	if (len < 0)
+		flip_u8(data, data, DIV_ROUND_UP(-len, 8));
 	return retval;
 }
 
+static int jtagspi_queue_read_status(struct flash_bank *bank, uint8_t *status)
+{
+	return jtagspi_queue_cmd(bank, SPIFLASH_READ_STATUS, NULL, status, -8);
+}
+
+/* SFDP reads take a 3-byte address followed by 8 dummy clocks, which is
+ * the same as a 4-byte address with a zero low byte. */
+static int jtagspi_read_sfdp_block(struct flash_bank *bank, uint32_t addr,
+		uint32_t words, uint32_t *buffer)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	bool addr4b = info->addr4b;
+	uint32_t sfdp_addr = addr << 8;
+
+	info->addr4b = true;
+	int retval = jtagspi_cmd(bank, SPIFLASH_READ_SFDP, &sfdp_addr,
+			(uint8_t *) buffer, -(int)(words * 32));
+	info->addr4b = addr4b;
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (uint32_t i = 0; i < words; i++)
+		buffer[i] = le_to_h_u32((uint8_t *) &buffer[i]);
+	return ERROR_OK;
+}
+
+/* 4-byte address variant of a read, program or erase opcode, 0 if unknown */
+static uint8_t jtagspi_opcode_4b(uint8_t opcode)
+{
+	switch (opcode) {
+	case 0x03:
+	case 0x13:
+		return 0x13;	/* read */
+	case 0x02:
+	case 0x12:
+		return 0x12;	/* page program */
+	case 0x20:
+	case 0x21:
+		return 0x21;	/* 4 KiB erase */
+	case 0x52:
+	case 0x5c:
+		return 0x5c;	/* 32 KiB erase */
+	case 0xd8:
+	case 0xdc:
+		return 0xdc;	/* 64 KiB erase */
+	default:
+		return 0x00;
+	}
+}
+
 static int jtagspi_probe(struct flash_bank *bank)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
@@ -190,8 +271,11 @@ static int jtagspi_probe(struct flash_bank *bank)
 		}
 
 	if (!(info->dev)) {
-		LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
-		return ERROR_FAIL;
+		LOG_DEBUG("Unknown flash device (ID 0x%08" PRIx32 "), trying SFDP", id);
+		if (spi_sfdp(bank, id, jtagspi_read_sfdp_block, &info->dev) != ERROR_OK) {
+			LOG_ERROR("Unknown flash device (ID 0x%08" PRIx32 ")", id);
+			return ERROR_FAIL;
+		}
 	}
 
 	LOG_INFO("Found flash device \'%s\' (ID 0x%08" PRIx32 ")",
@@ -201,15 +285,37 @@ static int jtagspi_probe(struct flash_bank *bank)
 	bank->size = info->dev->size_in_bytes;
 	if (bank->size <= (1UL << 16))
 		LOG_WARNING("device needs 2-byte addresses - not implemented");
-	if (bank->size > (1UL << 24))
-		LOG_WARNING("device needs paging or 4-byte addresses - not implemented");
+
+	info->addr4b = false;
+	info->read_cmd = info->dev->read_cmd;
+	info->pprog_cmd = info->dev->pprog_cmd;
+	info->erase_cmd = info->dev->erase_cmd;
+
+	/* devices beyond 16 MiB need the 4-byte address opcodes, the table
+	 * lists the 3-byte ones for some of them */
+	if (bank->size > (1UL << 24)) {
+		uint8_t read_cmd = jtagspi_opcode_4b(info->read_cmd);
+		uint8_t pprog_cmd = jtagspi_opcode_4b(info->pprog_cmd);
+		uint8_t erase_cmd = jtagspi_opcode_4b(info->erase_cmd);
+
+		if (read_cmd && pprog_cmd && (erase_cmd || !info->erase_cmd)) {
+			info->read_cmd = read_cmd;
+			info->pprog_cmd = pprog_cmd;
+			info->erase_cmd = erase_cmd;
+			info->addr4b = true;
+		} else {
+			LOG_WARNING("no 4-byte address opcodes known, "
+				"only the first 16 MiB are accessible");
+			bank->size = 1UL << 24;
+		}
+	}
 
 	/* if no sectors, treat whole bank as single sector */
 	sectorsize = info->dev->sectorsize ?
-		info->dev->sectorsize : info->dev->size_in_bytes;
+		info->dev->sectorsize : bank->size;
 
 	/* create and fill sectors array */
-	bank->num_sectors = info->dev->size_in_bytes / sectorsize;
+	bank->num_sectors = bank->size / sectorsize;
 	sectors = malloc(sizeof(struct flash_sector) * bank->num_sectors);
 	if (sectors == NULL) {
 		LOG_ERROR("not enough memory");
@@ -228,57 +334,85 @@ static int jtagspi_probe(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
-static int jtagspi_read_status(struct flash_bank *bank, uint32_t *status)
+/* Check a batch of queued status reads after the JTAG queue was executed.
+ * Returns true as soon as one of them shows the device idle. */
+static bool jtagspi_status_idle(uint8_t *status, unsigned int count)
 {
-	uint8_t buf;
-	int err = jtagspi_cmd(bank, SPIFLASH_READ_STATUS, NULL, &buf, -8);
-	if (err == ERROR_OK) {
-		*status = buf;
-		/* LOG_DEBUG("status=0x%08" PRIx32, *status); */
+	for (unsigned int i = 0; i < count; i++) {
+		flip_u8(&status[i], &status[i], 1);
+		if ((status[i] & SPIFLASH_BSY_BIT) == 0)
+			return true;
 	}
-
-	return err;
+	return false;
 }
 
+/* Poll the status register until the device is idle. Every flush carries
+ * poll_count status reads, so no host side sleep is needed between them. */
 static int jtagspi_wait(struct flash_bank *bank, int timeout_ms)
 {
-	uint32_t status;
+	struct jtagspi_flash_bank *info = bank->driver_priv;
 	int64_t t0 = timeval_ms();
 	int64_t dt;
+	int retval;
+
+	uint8_t *status = malloc(info->poll_count);
+	if (status == NULL) {
+		LOG_ERROR("no memory for status buffer");
+		return ERROR_FAIL;
+	}
 
 	do {
 		dt = timeval_ms() - t0;
 
-		int retval = jtagspi_read_status(bank, &status);
+		for (unsigned int i = 0; i < info->poll_count; i++) {
+			retval = jtagspi_queue_read_status(bank, &status[i]);
+			if (retval != ERROR_OK)
+				goto out;
+		}
+		retval = jtag_execute_queue();
 		if (retval != ERROR_OK)
-			return retval;
+			goto out;
 
-		if ((status & SPIFLASH_BSY_BIT) == 0) {
+		if (jtagspi_status_idle(status, info->poll_count)) {
 			LOG_DEBUG("waited %" PRId64 " ms", dt);
-			return ERROR_OK;
+			goto out;
 		}
-		alive_sleep(1);
+		keep_alive();
 	} while (dt <= timeout_ms);
 
 	LOG_ERROR("timeout, device still busy");
-	return ERROR_FAIL;
+	retval = ERROR_FAIL;
+
+out:
+	free(status);
+	return retval;
 }
 
-static int jtagspi_write_enable(struct flash_bank *bank)
+static int jtagspi_check_write_enable(uint8_t status)
 {
-	uint32_t status;
+	flip_u8(&status, &status, 1);
+	if ((status & SPIFLASH_WE_BIT) == 0) {
+		LOG_ERROR("Cannot enable write to flash. Status=0x%02" PRIx8, status);
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
 
-	jtagspi_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+static int jtagspi_write_enable(struct flash_bank *bank)
+{
+	uint8_t status;
 
-	int retval = jtagspi_read_status(bank, &status);
+	int retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_queue_read_status(bank, &status);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtag_execute_queue();
 	if (retval != ERROR_OK)
 		return retval;
 
-	if ((status & SPIFLASH_WE_BIT) == 0) {
-		LOG_ERROR("Cannot enable write to flash. Status=0x%08" PRIx32, status);
-		return ERROR_FAIL;
-	}
-	return ERROR_OK;
+	return jtagspi_check_write_enable(status);
 }
 
 static int jtagspi_bulk_erase(struct flash_bank *bank)
@@ -293,7 +427,9 @@ static int jtagspi_bulk_erase(struct flash_bank *bank)
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, info->dev->chip_erase_cmd, NULL, NULL, 0);
+	retval = jtagspi_cmd(bank, info->dev->chip_erase_cmd, NULL, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
 	retval = jtagspi_wait(bank, bank->num_sectors*JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("took %" PRId64 " ms", timeval_ms() - t0);
 	return retval;
@@ -308,7 +444,9 @@ static int jtagspi_sector_erase(struct flash_bank *bank, int sector)
 	retval = jtagspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		return retval;
-	jtagspi_cmd(bank, info->dev->erase_cmd, &bank->sectors[sector].offset, NULL, 0);
+	retval = jtagspi_cmd(bank, info->erase_cmd, &bank->sectors[sector].offset, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
 	retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
 	LOG_INFO("sector %d took %" PRId64 " ms", sector, timeval_ms() - t0);
 	return retval;
@@ -339,7 +477,9 @@ static int jtagspi_erase(struct flash_bank *bank, int first, int last)
 		}
 	}
 
+	/* a chip erase would also hit what lies beyond a 16 MiB bank limit */
 	if (first == 0 && last == (bank->num_sectors - 1)
+		&& bank->size == info->dev->size_in_bytes
 		&& info->dev->chip_erase_cmd != info->dev->erase_cmd) {
 		LOG_DEBUG("Trying bulk erase.");
 		retval = jtagspi_bulk_erase(bank);
@@ -349,7 +489,7 @@ static int jtagspi_erase(struct flash_bank *bank, int first, int last)
 			LOG_WARNING("Bulk flash erase failed. Falling back to sector erase.");
 	}
 
-	if (info->dev->erase_cmd == 0x00)
+	if (info->erase_cmd == 0x00)
 		return ERROR_FLASH_OPER_UNSUPPORTED;
 
 	for (sector = first; sector <= last; sector++) {
@@ -381,19 +521,42 @@ static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offse
 		return ERROR_FLASH_BANK_NOT_PROBED;
 	}
 
-	jtagspi_cmd(bank, SPIFLASH_READ, &offset, buffer, -count*8);
-	return ERROR_OK;
+	return jtagspi_cmd(bank, info->read_cmd, &offset, buffer, -count*8);
 }
 
+/* Write enable, its status check, the page program and a first batch of
+ * status polls all go out in a single flush. Only if the device is still
+ * busy after that batch do we fall back to jtagspi_wait(). */
 static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	uint8_t we_status;
 	int retval;
 
-	retval = jtagspi_write_enable(bank);
-	if (retval != ERROR_OK)
-		return retval;
-	jtagspi_cmd(bank, SPIFLASH_PAGE_PROGRAM, &offset, (uint8_t *) buffer, count*8);
-	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+	uint8_t *status = malloc(info->poll_count);
+	if (status == NULL) {
+		LOG_ERROR("no memory for status buffer");
+		return ERROR_FAIL;
+	}
+
+	retval = jtagspi_queue_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, NULL, 0);
+	if (retval == ERROR_OK)
+		retval = jtagspi_queue_read_status(bank, &we_status);
+	if (retval == ERROR_OK)
+		retval = jtagspi_queue_cmd(bank, info->pprog_cmd, &offset,
+				(uint8_t *) buffer, count*8);
+	for (unsigned int i = 0; i < info->poll_count && retval == ERROR_OK; i++)
+		retval = jtagspi_queue_read_status(bank, &status[i]);
+	if (retval == ERROR_OK)
+		retval = jtag_execute_queue();
+	if (retval == ERROR_OK)
+		retval = jtagspi_check_write_enable(we_status);
+
+	if (retval == ERROR_OK && !jtagspi_status_idle(status, info->poll_count))
+		retval = jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+
+	free(status);
+	return retval;
 }
 
 static int jtagspi_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
@@ -432,14 +595,68 @@ static int jtagspi_info(struct flash_bank *bank, char *buf, int buf_size)
 	}
 
 	snprintf(buf, buf_size, "\nSPIFI flash information:\n"
-		"  Device \'%s\' (ID 0x%08" PRIx32 ")\n",
-		info->dev->name, info->dev->device_id);
+		"  Device \'%s\' (ID 0x%08" PRIx32 ")\n"
+		"  %d-byte addresses, %u status polls per flush\n",
+		info->dev->name, info->dev->device_id,
+		info->addr4b ? 4 : 3, info->poll_count);
 
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(jtagspi_handle_poll_count_command)
+{
+	struct flash_bank *bank;
+	struct jtagspi_flash_bank *info;
+	unsigned int count;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
+	if (retval != ERROR_OK)
+		return retval;
+	info = bank->driver_priv;
+
+	if (CMD_ARGC == 2) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], count);
+		if (count < 1 || count > JTAGSPI_MAX_POLL_COUNT) {
+			command_print(CMD, "poll count must be between 1 and %d",
+					JTAGSPI_MAX_POLL_COUNT);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		info->poll_count = count;
+	}
+
+	command_print(CMD, "%u", info->poll_count);
+	return ERROR_OK;
+}
+
+static const struct command_registration jtagspi_exec_command_handlers[] = {
+	{
+		.name = "poll_count",
+		.handler = jtagspi_handle_poll_count_command,
+		.mode = COMMAND_ANY,
+		.usage = "bank_id [count]",
+		.help = "Set or display the number of status register reads "
+			"queued behind each page program and per polling flush.",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration jtagspi_command_handlers[] = {
+	{
+		.name = "jtagspi",
+		.mode = COMMAND_ANY,
+		.help = "jtagspi flash command group",
+		.usage = "",
+		.chain = jtagspi_exec_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
 const struct flash_driver jtagspi_flash = {
 	.name = "jtagspi",
+	.commands = jtagspi_command_handlers,
 	.flash_bank_command = jtagspi_flash_bank_command,
 	.erase = jtagspi_erase,
 	.protect = jtagspi_protect,
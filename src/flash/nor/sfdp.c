@@ -0,0 +1,241 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "imp.h"
+#include "sfdp.h"
+
+#define SFDP_MAGIC			0x50444653	/* "SFDP" */
+#define SFDP_MAX_PHDRS		8
+#define SFDP_BFPT_WORDS		16
+
+#define SFDP_ID_BFPT		0xff00	/* basic flash parameter table */
+#define SFDP_ID_4BAIT		0xff84	/* 4-byte address instruction table */
+
+/* BFPT dword 1 */
+#define BFPT_ADDR_BYTES(x)	(((x) >> 17) & 0x3)
+#define BFPT_ADDR_4B_ONLY	2
+#define BFPT_FAST_114		(1 << 22)
+#define BFPT_FAST_144		(1 << 21)
+
+/* 4BAIT dword 1 */
+#define FOURBAIT_READ		(1 << 0)
+#define FOURBAIT_READ_114	(1 << 4)
+#define FOURBAIT_READ_144	(1 << 5)
+#define FOURBAIT_PP			(1 << 6)
+#define FOURBAIT_ERASE(n)	(1 << (9 + (n)))
+
+struct sfdp_cache_entry {
+	struct flash_device dev;
+	struct sfdp_cache_entry *next;
+};
+
+static struct sfdp_cache_entry *sfdp_cache;
+
+/* 4-byte address variant of common 3-byte address opcodes, 0 if unknown */
+static uint8_t sfdp_opcode_4b(uint8_t opcode)
+{
+	switch (opcode) {
+	case 0x03: return 0x13;	/* read */
+	case 0x02: return 0x12;	/* page program */
+	case 0x6b: return 0x6c;	/* 1-1-4 fast read */
+	case 0xeb: return 0xec;	/* 1-4-4 fast read */
+	case 0x20: return 0x21;	/* 4 KiB erase */
+	case 0x52: return 0x5c;	/* 32 KiB erase */
+	case 0xd8: return 0xdc;	/* 64 KiB erase */
+	default: return 0x00;
+	}
+}
+
+static int sfdp_parse(struct flash_bank *bank, uint32_t id,
+		read_sfdp_block_t read_sfdp_block, struct flash_device *dev)
+{
+	uint32_t header[2], phdr[2 * SFDP_MAX_PHDRS];
+	uint32_t bfpt[SFDP_BFPT_WORDS] = { 0 };
+	uint32_t fourbait[2] = { 0 };
+	bool have_bfpt = false, have_4bait = false;
+	int retval;
+
+	retval = read_sfdp_block(bank, 0x0, 2, header);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (header[0] != SFDP_MAGIC) {
+		LOG_DEBUG("no SFDP signature (0x%08" PRIx32 ")", header[0]);
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	unsigned int nph = MIN(((header[1] >> 16) & 0xff) + 1, SFDP_MAX_PHDRS);
+	LOG_DEBUG("SFDP rev %" PRIu32 ".%" PRIu32 ", %u parameter headers",
+			(header[1] >> 8) & 0xff, header[1] & 0xff, nph);
+
+	retval = read_sfdp_block(bank, 0x8, 2 * nph, phdr);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (unsigned int i = 0; i < nph; i++) {
+		uint16_t table_id = ((phdr[2 * i + 1] >> 16) & 0xff00) | (phdr[2 * i] & 0xff);
+		uint32_t words = (phdr[2 * i] >> 24) & 0xff;
+		uint32_t ptr = phdr[2 * i + 1] & 0xffffff;
+
+		LOG_DEBUG("SFDP table 0x%04" PRIx16 " at 0x%06" PRIx32 ", %" PRIu32 " words",
+				table_id, ptr, words);
+
+		if (table_id == SFDP_ID_BFPT && !have_bfpt && words >= 9) {
+			retval = read_sfdp_block(bank, ptr, MIN(words, SFDP_BFPT_WORDS), bfpt);
+			if (retval != ERROR_OK)
+				return retval;
+			have_bfpt = true;
+		} else if (table_id == SFDP_ID_4BAIT && !have_4bait && words >= 2) {
+			retval = read_sfdp_block(bank, ptr, 2, fourbait);
+			if (retval != ERROR_OK)
+				return retval;
+			have_4bait = true;
+		}
+	}
+
+	if (!have_bfpt) {
+		LOG_DEBUG("no basic flash parameter table");
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	memset(dev, 0, sizeof(*dev));
+	dev->name = "SFDP flash";
+	dev->device_id = id;
+	dev->chip_erase_cmd = 0xc7;
+
+	/* dword 2: density in bits */
+	if (bfpt[1] & (1UL << 31)) {
+		unsigned int n = bfpt[1] & 0x7fffffff;
+		if (n < 3 || n > 34) {
+			LOG_ERROR("SFDP: unsupported flash density 2^%u bits", n);
+			return ERROR_FLASH_BANK_NOT_PROBED;
+		}
+		dev->size_in_bytes = 1UL << (n - 3);
+	} else {
+		dev->size_in_bytes = (bfpt[1] + 1) / 8;
+	}
+
+	/* dwords 8 and 9: pick the largest erase type */
+	unsigned int erase_type = 0;
+	for (unsigned int i = 0; i < 4; i++) {
+		uint32_t et = bfpt[7 + i / 2] >> (16 * (i % 2));
+		unsigned int n = et & 0xff;
+		uint8_t opcode = (et >> 8) & 0xff;
+		if (n == 0 || n > 31 || (1UL << n) > dev->size_in_bytes)
+			continue;
+		if ((1UL << n) > dev->sectorsize) {
+			dev->sectorsize = 1UL << n;
+			dev->erase_cmd = opcode;
+			erase_type = i;
+		}
+	}
+	if (dev->sectorsize == 0 && (bfpt[0] & 0x3) == 0x1) {
+		/* only the legacy 4 KiB erase in dword 1 is described */
+		dev->sectorsize = 4096;
+		dev->erase_cmd = (bfpt[0] >> 8) & 0xff;
+	}
+
+	/* dword 11 (JESD216A and later): page size */
+	if (bfpt[10])
+		dev->pagesize = 1UL << ((bfpt[10] >> 4) & 0xf);
+	else
+		dev->pagesize = SPIFLASH_DEF_PAGESIZE;
+
+	dev->read_cmd = SPIFLASH_READ;
+	dev->pprog_cmd = SPIFLASH_PAGE_PROGRAM;
+	if (bfpt[0] & BFPT_FAST_144)
+		dev->qread_cmd = (bfpt[2] >> 8) & 0xff;
+	else if (bfpt[0] & BFPT_FAST_114)
+		dev->qread_cmd = (bfpt[2] >> 24) & 0xff;
+
+	/* Parts beyond 16 MiB are driven with 4-byte address opcodes */
+	if (dev->size_in_bytes > (1UL << 24) ||
+			BFPT_ADDR_BYTES(bfpt[0]) == BFPT_ADDR_4B_ONLY) {
+		if (have_4bait) {
+			dev->read_cmd = (fourbait[0] & FOURBAIT_READ) ? 0x13 : 0x00;
+			dev->pprog_cmd = (fourbait[0] & FOURBAIT_PP) ? 0x12 : 0x00;
+			if (fourbait[0] & FOURBAIT_READ_144)
+				dev->qread_cmd = 0xec;
+			else if (fourbait[0] & FOURBAIT_READ_114)
+				dev->qread_cmd = 0x6c;
+			else
+				dev->qread_cmd = 0x00;
+			if (dev->sectorsize && (fourbait[0] & FOURBAIT_ERASE(erase_type)))
+				dev->erase_cmd = (fourbait[1] >> (8 * erase_type)) & 0xff;
+			else
+				dev->erase_cmd = sfdp_opcode_4b(dev->erase_cmd);
+		} else {
+			dev->read_cmd = sfdp_opcode_4b(dev->read_cmd);
+			dev->pprog_cmd = sfdp_opcode_4b(dev->pprog_cmd);
+			dev->qread_cmd = sfdp_opcode_4b(dev->qread_cmd);
+			dev->erase_cmd = sfdp_opcode_4b(dev->erase_cmd);
+		}
+
+		if (dev->read_cmd == 0x00 || dev->pprog_cmd == 0x00) {
+			LOG_ERROR("SFDP: no 4-byte address read/program opcodes");
+			return ERROR_FLASH_BANK_NOT_PROBED;
+		}
+	}
+
+	if (dev->sectorsize == 0 || dev->erase_cmd == 0x00) {
+		LOG_WARNING("SFDP: no usable sector erase, treating flash as one sector");
+		dev->sectorsize = 0;
+		dev->erase_cmd = 0x00;
+	}
+
+	return ERROR_OK;
+}
+
+int spi_sfdp(struct flash_bank *bank, uint32_t id,
+		read_sfdp_block_t read_sfdp_block, const struct flash_device **dev)
+{
+	struct sfdp_cache_entry *entry;
+
+	for (entry = sfdp_cache; entry; entry = entry->next) {
+		if (entry->dev.device_id == id) {
+			*dev = &entry->dev;
+			return ERROR_OK;
+		}
+	}
+
+	entry = malloc(sizeof(*entry));
+	if (entry == NULL) {
+		LOG_ERROR("not enough memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = sfdp_parse(bank, id, read_sfdp_block, &entry->dev);
+	if (retval != ERROR_OK) {
+		free(entry);
+		return retval;
+	}
+
+	LOG_INFO("SFDP: %" PRIu32 " KiB, %" PRIu32 " KiB sectors (erase 0x%02" PRIx8
+			"), %" PRIu32 " byte pages, read 0x%02" PRIx8 ", quad read 0x%02" PRIx8
+			", program 0x%02" PRIx8,
+			entry->dev.size_in_bytes / 1024, entry->dev.sectorsize / 1024,
+			entry->dev.erase_cmd, entry->dev.pagesize, entry->dev.read_cmd,
+			entry->dev.qread_cmd, entry->dev.pprog_cmd);
+
+	entry->next = sfdp_cache;
+	sfdp_cache = entry;
+	*dev = &entry->dev;
+
+	return ERROR_OK;
+}
@@ -0,0 +1,35 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_FLASH_NOR_SFDP_H
+#define OPENOCD_FLASH_NOR_SFDP_H
+
+#include <flash/nor/spi.h>
+
+struct flash_bank;
+
+/* Read "words" 32-bit words of the SFDP area starting at byte address
+ * "addr" (command 0x5A, 3-byte address, 8 dummy clocks). The first byte
+ * read ends up in the least significant byte of buffer[0]. */
+typedef int (*read_sfdp_block_t)(struct flash_bank *bank, uint32_t addr,
+		uint32_t words, uint32_t *buffer);
+
+/* Describe the device with the given JEDEC id from its SFDP tables.
+ * Results are cached per id, so the tables are only read the first time
+ * a part is seen. On success *dev points to a static description. */
+int spi_sfdp(struct flash_bank *bank, uint32_t id,
+		read_sfdp_block_t read_sfdp_block, const struct flash_device **dev);
+
+#endif /* OPENOCD_FLASH_NOR_SFDP_H */
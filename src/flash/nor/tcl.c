@@ -961,6 +961,19 @@ COMMAND_HANDLER(handle_flash_verify_bank_command)
 		return ERROR_FAIL;
 	}
 
+	/* Let the driver check the contents in place if it can; on a mismatch
+	 * the data is read back below so the differences can be listed. */
+	if (flash_driver_verify(p, buffer_file, offset, length) == ERROR_OK) {
+		if (duration_measure(&bench) == ERROR_OK)
+			command_print(CMD, "verified %zd bytes from file %s against flash bank %u"
+				" at offset 0x%8.8" PRIx32 " in %fs (%0.3f KiB/s)",
+				length, CMD_ARGV[1], p->bank_number, offset,
+				duration_elapsed(&bench), duration_kbps(&bench, length));
+		command_print(CMD, "contents match");
+		free(buffer_file);
+		return ERROR_OK;
+	}
+
 	buffer_flash = malloc(length);
 	if (buffer_flash == NULL) {
 		LOG_ERROR("Out of memory");
@@ -181,6 +181,10 @@ struct pending_transfer_result {
 struct pending_request_block {
 	struct pending_transfer_result *transfers;
 	int transfer_count;
+	int read_count;
+	/* All transfers use the same request, so the block can be sent
+	 * as a DAP_TransferBlock */
+	bool same_request;
 };
 
 struct pending_scan_result {
@@ -627,6 +631,42 @@ static int cmsis_dap_cmd_DAP_Delay(uint16_t delay_us)
 }
 #endif
 
+/**
+ * Check whether a transfer with request @a cmd can be added to @a block,
+ * given the request and response sizes of the DAP_Transfer or, for runs of
+ * identical requests, DAP_TransferBlock command the block will be sent as.
+ */
+static bool cmsis_dap_swd_block_fits(struct cmsis_dap *dap,
+		const struct pending_request_block *block, uint8_t cmd)
+{
+	int count = block->transfer_count + 1;
+	int reads = block->read_count + ((cmd & SWD_CMD_RnW) ? 1 : 0);
+	int writes = count - reads;
+	bool same_request = block->transfer_count == 0 ||
+		(block->same_request && block->transfers[0].cmd == cmd);
+	int request_size, response_size;
+
+	if (count > pending_queue_len)
+		return false;
+
+	if (same_request) {
+		/* command, DAP index, 16 bit count, request, data */
+		request_size = 5 + 4 * writes;
+		/* command, 16 bit count, response, data */
+		response_size = 4 + 4 * reads;
+	} else {
+		if (count > 255)
+			return false;
+		/* command, DAP index, count, one request byte each, data */
+		request_size = 3 + count + 4 * writes;
+		/* command, count, response, data */
+		response_size = 3 + 4 * reads;
+	}
+
+	/* packet_size includes the HID report number */
+	return request_size <= dap->packet_size - 1 && response_size <= dap->packet_size - 1;
+}
+
 static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 {
 	uint8_t *buffer = dap->packet_buffer;
@@ -644,9 +684,19 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 
 	size_t idx = 0;
 	buffer[idx++] = 0;	/* report number */
-	buffer[idx++] = CMD_DAP_TFER;
-	buffer[idx++] = 0x00;	/* DAP Index */
-	buffer[idx++] = block->transfer_count;
+	if (block->same_request && block->transfer_count > 1) {
+		/* A run of accesses to the same register, e.g. DRW by
+		 * mem_ap_read()/mem_ap_write(): one request byte for all */
+		buffer[idx++] = CMD_DAP_TFER_BLOCK;
+		buffer[idx++] = 0x00;	/* DAP Index */
+		buffer[idx++] = block->transfer_count & 0xff;
+		buffer[idx++] = (block->transfer_count >> 8) & 0xff;
+		buffer[idx++] = (block->transfers[0].cmd >> 1) & 0x0f;
+	} else {
+		buffer[idx++] = CMD_DAP_TFER;
+		buffer[idx++] = 0x00;	/* DAP Index */
+		buffer[idx++] = block->transfer_count;
+	}
 
 	for (int i = 0; i < block->transfer_count; i++) {
 		struct pending_transfer_result *transfer = &(block->transfers[i]);
@@ -677,7 +727,8 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 			data &= ~CORUNDETECT;
 		}
 
-		buffer[idx++] = (cmd >> 1) & 0x0f;
+		if (buffer[1] == CMD_DAP_TFER)
+			buffer[idx++] = (cmd >> 1) & 0x0f;
 		if (!(cmd & SWD_CMD_RnW)) {
 			buffer[idx++] = (data) & 0xff;
 			buffer[idx++] = (data >> 8) & 0xff;
@@ -699,6 +750,7 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 
 skip:
 	block->transfer_count = 0;
+	block->read_count = 0;
 }
 
 static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, int timeout_ms)
@@ -720,26 +772,42 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, int timeout_ms)
 		goto skip;
 	}
 
-	if (buffer[2] & 0x08) {
-		LOG_DEBUG("CMSIS-DAP Protocol Error @ %d (wrong parity)", buffer[1]);
-		queued_retval = ERROR_FAIL;
-		goto skip;
+	/* DAP_Transfer and DAP_TransferBlock only differ in the width of the count */
+	int count;
+	uint8_t response;
+	size_t idx;
+	if (buffer[0] == CMD_DAP_TFER_BLOCK) {
+		count = le_to_h_u16(&buffer[1]);
+		response = buffer[3];
+		idx = 4;
+	} else {
+		count = buffer[1];
+		response = buffer[2];
+		idx = 3;
 	}
-	uint8_t ack = buffer[2] & 0x07;
-	if (ack != SWD_ACK_OK) {
-		LOG_DEBUG("SWD ack not OK @ %d %s", buffer[1],
-			  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
-		queued_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
+
+	/* The transfers before the failing one were executed, so the
+	 * error belongs to transfer number "count" of this block */
+	if (response & 0x08 || (response & 0x07) != SWD_ACK_OK) {
+		uint8_t ack = response & 0x07;
+		uint8_t cmd = count < block->transfer_count ? block->transfers[count].cmd : 0;
+		if (response & 0x08)
+			LOG_DEBUG("CMSIS-DAP Protocol Error @ %d (wrong parity)", count);
+		else
+			LOG_DEBUG("SWD ack not OK @ %d %s", count,
+				  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
+		LOG_DEBUG("failed transfer: %s %s reg %x", cmd & SWD_CMD_APnDP ? "AP" : "DP",
+			  cmd & SWD_CMD_RnW ? "read" : "write", (cmd & SWD_CMD_A32) >> 1);
+		queued_retval = ack == SWD_ACK_WAIT && !(response & 0x08) ? ERROR_WAIT : ERROR_FAIL;
 		goto skip;
 	}
 
-	if (block->transfer_count != buffer[1])
+	if (block->transfer_count != count)
 		LOG_ERROR("CMSIS-DAP transfer count mismatch: expected %d, got %d",
-			  block->transfer_count, buffer[1]);
+			  block->transfer_count, count);
 
-	LOG_DEBUG_IO("Received results of %d queued transactions FIFO index %d", buffer[1], pending_fifo_get_idx);
-	size_t idx = 3;
-	for (int i = 0; i < buffer[1]; i++) {
+	LOG_DEBUG_IO("Received results of %d queued transactions FIFO index %d", count, pending_fifo_get_idx);
+	for (int i = 0; i < count; i++) {
 		struct pending_transfer_result *transfer = &(block->transfers[i]);
 		if (transfer->cmd & SWD_CMD_RnW) {
 			static uint32_t last_read;
@@ -763,6 +831,7 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, int timeout_ms)
 
 skip:
 	block->transfer_count = 0;
+	block->read_count = 0;
 	pending_fifo_get_idx = (pending_fifo_get_idx + 1) % dap->packet_count;
 	pending_fifo_block_count--;
 }
@@ -788,7 +857,7 @@ static int cmsis_dap_swd_run_queue(void)
 
 static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 {
-	if (pending_fifo[pending_fifo_put_idx].transfer_count == pending_queue_len) {
+	if (!cmsis_dap_swd_block_fits(cmsis_dap_handle, &pending_fifo[pending_fifo_put_idx], cmd)) {
 		if (pending_fifo_block_count)
 			cmsis_dap_swd_read_process(cmsis_dap_handle, 0);
 
@@ -809,7 +878,10 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	if (cmd & SWD_CMD_RnW) {
 		/* Queue a read transaction */
 		transfer->buffer = dst;
+		block->read_count++;
 	}
+	block->same_request = block->transfer_count == 0 ||
+		(block->same_request && block->transfers[0].cmd == cmd);
 	block->transfer_count++;
 }
 
@@ -1018,10 +1090,11 @@ static int cmsis_dap_init(void)
 	if (data[0] == 2) {  /* short */
 		uint16_t pkt_sz = data[1] + (data[2] << 8);
 
-		/* 4 bytes of command header + 5 bytes per register
-		 * write. For bulk read sequences just 4 bytes are
-		 * needed per transfer, so this is suboptimal. */
-		pending_queue_len = (pkt_sz - 4) / 5;
+		/* Upper bound of transfers per packet, reached by reads
+		 * (3 bytes of response header + 4 bytes per read). How
+		 * many actually fit depends on the mix of reads and writes,
+		 * see cmsis_dap_swd_block_fits(). */
+		pending_queue_len = (pkt_sz - 3) / 4;
 
 		if (cmsis_dap_handle->packet_size != pkt_sz + 1) {
 			/* reallocate buffer */
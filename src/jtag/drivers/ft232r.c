@@ -103,6 +103,131 @@ static size_t ft232r_buf_size = FT232R_BUF_SIZE_EXTRA;
  */
 static uint16_t ft232r_restore_bitmode = 0xFFFF;
 
+/*
+ * FIFO TX buffer has 128 bytes.
+ * FIFO RX buffer has 256 bytes.
+ * First two bytes of received packet contain contain modem
+ * and line status and are ignored.
+ * Unfortunately, transfer sizes bigger than 64 bytes
+ * frequently cause hang ups.
+ *
+ * Several 64 byte transfers are kept in flight in each direction, so the
+ * TX FIFO never runs dry while we wait for the replies. Bytes written but
+ * not yet read back are kept within half of the 256 byte RX FIFO, the
+ * budget the synchronous loop always used, so no sample is lost.
+ */
+#define FT232R_RX_FIFO_SIZE	128
+#define FT232R_PACKET_SIZE	64
+#define FT232R_MAX_WRITES	4
+#define FT232R_MAX_READS	4
+
+struct ft232r_xfer {
+	struct libusb_transfer *transfer;
+	uint8_t buf[FT232R_PACKET_SIZE];	/* read transfers only */
+	bool busy;
+};
+
+static struct ft232r_xfer ft232r_writes[FT232R_MAX_WRITES];
+static struct ft232r_xfer ft232r_reads[FT232R_MAX_READS];
+
+/* Progress of the transaction in ft232r_send_recv() */
+static size_t ft232r_submitted;
+static size_t ft232r_received;
+static int ft232r_xfer_retval;
+static int ft232r_xfer_event;
+
+static LIBUSB_CALL void ft232r_write_cb(struct libusb_transfer *transfer)
+{
+	struct ft232r_xfer *xfer = transfer->user_data;
+
+	xfer->busy = false;
+	ft232r_xfer_event = 1;
+
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED)
+		return;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED ||
+			transfer->actual_length != transfer->length) {
+		LOG_ERROR("usb bulk write failed");
+		ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+	}
+}
+
+static LIBUSB_CALL void ft232r_read_cb(struct libusb_transfer *transfer)
+{
+	struct ft232r_xfer *xfer = transfer->user_data;
+
+	xfer->busy = false;
+	ft232r_xfer_event = 1;
+
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED)
+		return;
+	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
+		LOG_ERROR("usb bulk read failed");
+		ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+		return;
+	}
+
+	/* Reads on one endpoint complete in submission order, so the data
+	 * can be appended as it arrives. Copy data, ignoring first 2 bytes. */
+	if (transfer->actual_length > 2) {
+		size_t bytes_read = transfer->actual_length - 2;
+		if (ft232r_received + bytes_read > ft232r_submitted) {
+			LOG_ERROR("read more bytes than wrote");
+			ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
+			return;
+		}
+		memcpy(ft232r_output + ft232r_received, xfer->buf + 2, bytes_read);
+		ft232r_received += bytes_read;
+	}
+}
+
+static int ft232r_submit(struct ft232r_xfer *xfer, unsigned char endpoint, uint8_t *buf,
+	int length, libusb_transfer_cb_fn callback)
+{
+	libusb_fill_bulk_transfer(xfer->transfer, adapter, endpoint, buf, length,
+		callback, xfer, 1000);
+
+	int retval = libusb_submit_transfer(xfer->transfer);
+	if (retval != LIBUSB_SUCCESS) {
+		LOG_ERROR("usb bulk transfer submission failed: %s", libusb_error_name(retval));
+		return ERROR_JTAG_DEVICE_ERROR;
+	}
+
+	xfer->busy = true;
+	return ERROR_OK;
+}
+
+/**
+ * Wait until no transfer is in flight, cancelling them first if requested.
+ */
+static void ft232r_wait_idle(bool cancel)
+{
+	for (;;) {
+		bool busy = false;
+		for (int i = 0; i < FT232R_MAX_WRITES; i++) {
+			if (ft232r_writes[i].busy) {
+				busy = true;
+				if (cancel)
+					libusb_cancel_transfer(ft232r_writes[i].transfer);
+			}
+		}
+		for (int i = 0; i < FT232R_MAX_READS; i++) {
+			if (ft232r_reads[i].busy) {
+				busy = true;
+				if (cancel)
+					libusb_cancel_transfer(ft232r_reads[i].transfer);
+			}
+		}
+		if (!busy)
+			return;
+
+		cancel = false;
+		ft232r_xfer_event = 0;
+		if (jtag_libusb_handle_events_completed(&ft232r_xfer_event) != ERROR_OK)
+			return;
+	}
+}
+
 /**
  * Perform sync bitbang output/input transaction.
  * Before call, an array ft232r_output[] should be filled with data to send.
@@ -111,63 +236,63 @@ static uint16_t ft232r_restore_bitmode = 0xFFFF;
  */
 static int ft232r_send_recv(void)
 {
-	/* FIFO TX buffer has 128 bytes.
-	 * FIFO RX buffer has 256 bytes.
-	 * First two bytes of received packet contain contain modem
-	 * and line status and are ignored.
-	 * Unfortunately, transfer sizes bigger than 64 bytes
-	 * frequently cause hang ups. */
 	assert(ft232r_output_len > 0);
 
-	size_t total_written = 0;
-	size_t total_read = 0;
-	int rxfifo_free = 128;
+	ft232r_submitted = 0;
+	ft232r_received = 0;
+	ft232r_xfer_retval = ERROR_OK;
 
-	while (total_read < ft232r_output_len) {
+	while (ft232r_received < ft232r_output_len && ft232r_xfer_retval == ERROR_OK) {
 		/* Write */
-		int bytes_to_write = ft232r_output_len - total_written;
-		if (bytes_to_write > 64)
-			bytes_to_write = 64;
-		if (bytes_to_write > rxfifo_free)
-			bytes_to_write = rxfifo_free;
-
-		if (bytes_to_write) {
-			int n;
-
-			if (jtag_libusb_bulk_write(adapter, IN_EP,
-						   (char *) ft232r_output + total_written,
-						   bytes_to_write, 1000, &n) != ERROR_OK) {
-				LOG_ERROR("usb bulk write failed");
-				return ERROR_JTAG_DEVICE_ERROR;
-			}
+		for (int i = 0; i < FT232R_MAX_WRITES && ft232r_submitted < ft232r_output_len; i++) {
+			if (ft232r_writes[i].busy)
+				continue;
 
-			total_written += n;
-			rxfifo_free -= n;
-		}
+			size_t in_flight = ft232r_submitted - ft232r_received;
+			if (in_flight >= FT232R_RX_FIFO_SIZE)
+				break;
 
-		/* Read */
-		uint8_t reply[64];
-		int n;
+			size_t bytes_to_write = ft232r_output_len - ft232r_submitted;
+			if (bytes_to_write > FT232R_PACKET_SIZE)
+				bytes_to_write = FT232R_PACKET_SIZE;
+			if (bytes_to_write > FT232R_RX_FIFO_SIZE - in_flight)
+				bytes_to_write = FT232R_RX_FIFO_SIZE - in_flight;
 
-		if (jtag_libusb_bulk_read(adapter, OUT_EP, (char *) reply,
-					  sizeof(reply), 1000, &n) != ERROR_OK) {
-			LOG_ERROR("usb bulk read failed");
-			return ERROR_JTAG_DEVICE_ERROR;
+			ft232r_xfer_retval = ft232r_submit(&ft232r_writes[i], IN_EP,
+					ft232r_output + ft232r_submitted, bytes_to_write, ft232r_write_cb);
+			if (ft232r_xfer_retval != ERROR_OK)
+				break;
+			ft232r_submitted += bytes_to_write;
 		}
-		if (n > 2) {
-			/* Copy data, ignoring first 2 bytes. */
-			memcpy(ft232r_output + total_read, reply + 2, n - 2);
-			int bytes_read = n - 2;
-			total_read += bytes_read;
-			rxfifo_free += bytes_read;
-			if (total_read > total_written) {
-				LOG_ERROR("read more bytes than wrote");
-				return ERROR_JTAG_DEVICE_ERROR;
-			}
+
+		/* Read: keep enough packets posted to cover everything in flight */
+		int reads_posted = 0;
+		for (int i = 0; i < FT232R_MAX_READS; i++)
+			if (ft232r_reads[i].busy)
+				reads_posted++;
+		for (int i = 0; i < FT232R_MAX_READS && ft232r_xfer_retval == ERROR_OK; i++) {
+			if (ft232r_reads[i].busy)
+				continue;
+			if (ft232r_received + reads_posted * (FT232R_PACKET_SIZE - 2) >= ft232r_submitted)
+				break;
+
+			ft232r_xfer_retval = ft232r_submit(&ft232r_reads[i], OUT_EP,
+					ft232r_reads[i].buf, FT232R_PACKET_SIZE, ft232r_read_cb);
+			reads_posted++;
 		}
+
+		if (ft232r_xfer_retval != ERROR_OK)
+			break;
+
+		ft232r_xfer_event = 0;
+		if (jtag_libusb_handle_events_completed(&ft232r_xfer_event) != ERROR_OK)
+			ft232r_xfer_retval = ERROR_JTAG_DEVICE_ERROR;
 	}
+
+	ft232r_wait_idle(ft232r_xfer_retval != ERROR_OK);
+
 	ft232r_output_len = 0;
-	return ERROR_OK;
+	return ft232r_xfer_retval;
 }
 
 void ft232r_increase_buf_size(size_t new_buf_size)
@@ -315,6 +440,21 @@ static int ft232r_init(void)
 		return ERROR_JTAG_INIT_FAILED;
 	}
 
+	for (int i = 0; i < FT232R_MAX_WRITES; i++) {
+		ft232r_writes[i].transfer = libusb_alloc_transfer(0);
+		if (ft232r_writes[i].transfer == NULL) {
+			LOG_ERROR("Unable to allocate usb transfers");
+			return ERROR_JTAG_INIT_FAILED;
+		}
+	}
+	for (int i = 0; i < FT232R_MAX_READS; i++) {
+		ft232r_reads[i].transfer = libusb_alloc_transfer(0);
+		if (ft232r_reads[i].transfer == NULL) {
+			LOG_ERROR("Unable to allocate usb transfers");
+			return ERROR_JTAG_INIT_FAILED;
+		}
+	}
+
 	return ERROR_OK;
 }
 
@@ -330,6 +470,15 @@ static int ft232r_quit(void)
 		}
 	}
 
+	for (int i = 0; i < FT232R_MAX_WRITES; i++) {
+		libusb_free_transfer(ft232r_writes[i].transfer);
+		ft232r_writes[i].transfer = NULL;
+	}
+	for (int i = 0; i < FT232R_MAX_READS; i++) {
+		libusb_free_transfer(ft232r_reads[i].transfer);
+		ft232r_reads[i].transfer = NULL;
+	}
+
 	if (libusb_release_interface(adapter, 0) != 0)
 		LOG_ERROR("usb release interface failed");
 
@@ -89,10 +89,12 @@
 #define DO_CLOCK_DATA clock_data
 #define DO_CLOCK_TMS_CS clock_tms_cs
 #define DO_CLOCK_TMS_CS_OUT clock_tms_cs_out
+#define DO_CLOCK_IDLE clock_idle
 #else
 #define DO_CLOCK_DATA mpsse_clock_data
 #define DO_CLOCK_TMS_CS mpsse_clock_tms_cs
 #define DO_CLOCK_TMS_CS_OUT mpsse_clock_tms_cs_out
+#define DO_CLOCK_IDLE mpsse_clock_idle
 #endif
 
 #define JTAG_MODE (LSB_FIRST | POS_EDGE_IN | NEG_EDGE_OUT)
@@ -155,6 +157,7 @@ static struct signal *signals;
 static struct swd_cmd_queue_entry {
 	uint8_t cmd;
 	uint32_t *dst;
+	uint32_t ap_delay_clk;
 	uint8_t trn_ack_data_parity_trn[DIV_ROUND_UP(4 + 3 + 32 + 1 + 4, 8)];
 } *swd_cmd_queue;
 static size_t swd_cmd_queue_length;
@@ -162,6 +165,9 @@ static size_t swd_cmd_queue_alloced;
 static int queued_retval;
 static int freq;
 
+/* How long a transaction tail answered with WAIT is replayed before giving up */
+#define SWD_WAIT_TIMEOUT_MS 500
+
 static uint16_t output;
 static uint16_t direction;
 static uint16_t jtag_output_init;
@@ -303,6 +309,22 @@ static void clock_tms_cs_out(struct mpsse_ctx *ctx, const uint8_t *out, unsigned
 	else
 		mpsse_clock_tms_cs_out(ctx, out, out_offset, length, tdi, mode);
 }
+
+static void clock_idle(struct mpsse_ctx *ctx, unsigned length, uint8_t mode)
+{
+	static const uint8_t zero;
+
+	if (!oscan1_mode) {
+		mpsse_clock_idle(ctx, length, mode);
+		return;
+	}
+
+	while (length > 0) {
+		unsigned this_len = length > 7 ? 7 : length;
+		oscan1_mpsse_clock_tms_cs_out(ctx, &zero, 0, this_len, false, mode);
+		length -= this_len;
+	}
+}
 #endif
 
 /**
@@ -384,7 +406,11 @@ static void ftdi_end_state(tap_state_t state)
 	}
 }
 
-static void ftdi_execute_runtest(struct jtag_command *cmd)
+/**
+ * Execute a runtest. @a cycles_done idle cycles were already clocked by the
+ * preceding scan on its way into Run-Test/Idle (see ftdi_execute_scan()).
+ */
+static void ftdi_execute_runtest(struct jtag_command *cmd, int cycles_done)
 {
 	int i;
 	static const uint8_t zero;
@@ -396,14 +422,17 @@ static void ftdi_execute_runtest(struct jtag_command *cmd)
 	if (tap_get_state() != TAP_IDLE)
 		move_to_state(TAP_IDLE);
 
-	/* TODO: Reuse ftdi_execute_stableclocks */
-	i = cmd->cmd.runtest->num_cycles;
-	while (i > 0) {
-		/* there are no state transitions in this code, so omit state tracking */
+	i = cmd->cmd.runtest->num_cycles - cycles_done;
+	if (i > 0 && cycles_done == 0) {
+		/* Clock the first cycles with TMS explicitly low, so the remainder
+		 * can use clock-only commands that leave TMS untouched. */
 		unsigned this_len = i > 7 ? 7 : i;
 		DO_CLOCK_TMS_CS_OUT(mpsse_ctx, &zero, 0, this_len, false, ftdi_jtag_mode);
 		i -= this_len;
 	}
+	/* there are no state transitions in this code, so omit state tracking */
+	if (i > 0)
+		DO_CLOCK_IDLE(mpsse_ctx, i, ftdi_jtag_mode);
 
 	ftdi_end_state(cmd->cmd.runtest->end_state);
 
@@ -495,8 +524,18 @@ static void ftdi_execute_pathmove(struct jtag_command *cmd)
 	tap_set_end_state(tap_get_state());
 }
 
-static void ftdi_execute_scan(struct jtag_command *cmd)
+/**
+ * Execute a scan. When the scan ends in Run-Test/Idle, the TMS sequence that
+ * leaves the shift state is a fixed template (Exit1 -> Update -> Run-Test/Idle),
+ * so up to @a idle_cycles of a following runtest are appended to the same
+ * MPSSE TMS command instead of detouring through Pause.
+ *
+ * @returns the number of idle cycles clocked.
+ */
+static int ftdi_execute_scan(struct jtag_command *cmd, int idle_cycles)
 {
+	int cycles_done = 0;
+
 	LOG_DEBUG_IO("%s type:%d", cmd->cmd.scan->ir_scan ? "IRSCAN" : "DRSCAN",
 		jtag_scan_type(cmd->cmd.scan));
 
@@ -509,7 +548,7 @@ static void ftdi_execute_scan(struct jtag_command *cmd)
 
 	if (cmd->cmd.scan->num_fields == 0) {
 		LOG_DEBUG_IO("empty scan, doing nothing");
-		return;
+		return 0;
 	}
 
 	if (cmd->cmd.scan->ir_scan) {
@@ -557,13 +596,28 @@ static void ftdi_execute_scan(struct jtag_command *cmd)
 					last_bit,
 					ftdi_jtag_mode);
 			tap_set_state(tap_state_transition(tap_get_state(), 1));
-			DO_CLOCK_TMS_CS_OUT(mpsse_ctx,
-					&tms_bits,
-					1,
-					1,
-					last_bit,
-					ftdi_jtag_mode);
-			tap_set_state(tap_state_transition(tap_get_state(), 0));
+			if (tap_get_end_state() == TAP_IDLE) {
+				/* TMS 1, 0 reaches Run-Test/Idle, further zeros are idle
+				 * cycles; at most 7 bits fit in one TMS command. */
+				cycles_done = MIN(idle_cycles, 7 - 2);
+				uint8_t exit_bits = 0x01;
+				DO_CLOCK_TMS_CS_OUT(mpsse_ctx,
+						&exit_bits,
+						0,
+						2 + cycles_done,
+						last_bit,
+						ftdi_jtag_mode);
+				tap_set_state(tap_state_transition(tap_get_state(), 1));
+				tap_set_state(tap_state_transition(tap_get_state(), 0));
+			} else {
+				DO_CLOCK_TMS_CS_OUT(mpsse_ctx,
+						&tms_bits,
+						1,
+						1,
+						last_bit,
+						ftdi_jtag_mode);
+				tap_set_state(tap_state_transition(tap_get_state(), 0));
+			}
 		} else
 			DO_CLOCK_DATA(mpsse_ctx,
 				field->out_value,
@@ -580,6 +634,8 @@ static void ftdi_execute_scan(struct jtag_command *cmd)
 	LOG_DEBUG_IO("%s scan, %i bits, end in %s",
 		(cmd->cmd.scan->ir_scan) ? "IR" : "DR", scan_size,
 		tap_state_name(tap_get_end_state()));
+
+	return cycles_done;
 }
 
 static int ftdi_reset(int trst, int srst)
@@ -662,7 +718,7 @@ static void ftdi_execute_command(struct jtag_command *cmd)
 #endif
 			break;
 		case JTAG_RUNTEST:
-			ftdi_execute_runtest(cmd);
+			ftdi_execute_runtest(cmd, 0);
 			break;
 		case JTAG_TLR_RESET:
 			ftdi_execute_statemove(cmd);
@@ -674,7 +730,7 @@ static void ftdi_execute_command(struct jtag_command *cmd)
 			ftdi_execute_pathmove(cmd);
 			break;
 		case JTAG_SCAN:
-			ftdi_execute_scan(cmd);
+			ftdi_execute_scan(cmd, 0);
 			break;
 		case JTAG_SLEEP:
 			ftdi_execute_sleep(cmd);
@@ -699,6 +755,16 @@ static int ftdi_execute_queue(void)
 		ftdi_set_signal(led, '1');
 
 	for (struct jtag_command *cmd = jtag_command_queue; cmd; cmd = cmd->next) {
+		/* A scan ending in Run-Test/Idle followed by a runtest (e.g. a RISC-V
+		 * DMI access) shares its TMS command with the first idle cycles. */
+		if (cmd->type == JTAG_SCAN && cmd->cmd.scan->end_state == TAP_IDLE &&
+				cmd->next && cmd->next->type == JTAG_RUNTEST) {
+			int cycles_done = ftdi_execute_scan(cmd, cmd->next->cmd.runtest->num_cycles);
+			cmd = cmd->next;
+			ftdi_execute_runtest(cmd, cycles_done);
+			continue;
+		}
+
 		/* fill the write buffer with the desired command */
 		ftdi_execute_command(cmd);
 	}
@@ -1393,7 +1459,8 @@ static int ftdi_swd_init(void)
 	if (create_signals() != ERROR_OK)
 		return ERROR_FAIL;
 
-	swd_cmd_queue_alloced = 10;
+	/* Room for a few hundred transactions per MPSSE burst; grows if needed */
+	swd_cmd_queue_alloced = 256;
 	swd_cmd_queue = malloc(swd_cmd_queue_alloced * sizeof(*swd_cmd_queue));
 
 	return swd_cmd_queue != NULL ? ERROR_OK : ERROR_FAIL;
@@ -1417,6 +1484,55 @@ static void ftdi_swd_swdio_en(bool enable)
 	}
 }
 
+static void ftdi_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk);
+
+/**
+ * Re-queue the transactions from @a first on, after the target answered
+ * transaction @a first with WAIT. With overrun detection enabled the target
+ * ignores everything after a WAIT, so only this tail has to be replayed,
+ * preceded by an ABORT write clearing the overrun flag. The transactions
+ * before @a first completed and their results were already delivered.
+ *
+ * @returns false if a later transaction completed anyway, in which case the
+ * tail can't be replayed in order.
+ */
+static bool ftdi_swd_requeue_tail(size_t first)
+{
+	size_t tail = swd_cmd_queue_length - first;
+
+	for (size_t i = first + 1; i < swd_cmd_queue_length; i++)
+		if (buf_get_u32(swd_cmd_queue[i].trn_ack_data_parity_trn, 1, 3) == SWD_ACK_OK)
+			return false;
+
+	struct swd_cmd_queue_entry *replay = malloc(tail * sizeof(*replay));
+	if (replay == NULL)
+		return false;
+	memcpy(replay, swd_cmd_queue + first, tail * sizeof(*replay));
+	swd_cmd_queue_length = 0;
+
+	/* The replay plus the ABORT must fit without running the queue */
+	if (tail + 1 > swd_cmd_queue_alloced) {
+		struct swd_cmd_queue_entry *q = realloc(swd_cmd_queue, (tail + 1) * sizeof(*swd_cmd_queue));
+		if (q == NULL) {
+			free(replay);
+			return false;
+		}
+		swd_cmd_queue = q;
+		swd_cmd_queue_alloced = tail + 1;
+	}
+
+	ftdi_swd_queue_cmd(swd_cmd(false, false, DP_ABORT), NULL, ORUNERRCLR, 0);
+	for (size_t i = 0; i < tail; i++) {
+		uint32_t data = 0;
+		if (!(replay[i].cmd & SWD_CMD_RnW))
+			data = buf_get_u32(replay[i].trn_ack_data_parity_trn, 1 + 3 + 1, 32);
+		ftdi_swd_queue_cmd(replay[i].cmd, replay[i].dst, data, replay[i].ap_delay_clk);
+	}
+
+	free(replay);
+	return true;
+}
+
 /**
  * Flush the MPSSE queue and process the SWD transaction queue
  * @param dap
@@ -1427,12 +1543,14 @@ static int ftdi_swd_run_queue(void)
 	LOG_DEBUG_IO("Executing %zu queued transactions", swd_cmd_queue_length);
 	int retval;
 	struct signal *led = find_signal_by_name("LED");
+	int64_t wait_start = 0;
 
 	if (queued_retval != ERROR_OK) {
 		LOG_DEBUG_IO("Skipping due to previous errors: %d", queued_retval);
 		goto skip;
 	}
 
+retry:
 	/* A transaction must be followed by another transaction or at least 8 idle cycles to
 	 * ensure that data is clocked through the AP. */
 	mpsse_clock_data_out(mpsse_ctx, NULL, 0, 8, SWD_MODE);
@@ -1459,6 +1577,15 @@ static int ftdi_swd_run_queue(void)
 						1 + 3 + (swd_cmd_queue[i].cmd & SWD_CMD_RnW ? 0 : 1), 32));
 
 		if (ack != SWD_ACK_OK) {
+			if (ack == SWD_ACK_WAIT) {
+				if (wait_start == 0)
+					wait_start = timeval_ms();
+				size_t tail = swd_cmd_queue_length - i;
+				if (timeval_ms() - wait_start < SWD_WAIT_TIMEOUT_MS && ftdi_swd_requeue_tail(i)) {
+					LOG_DEBUG_IO("WAIT, replaying the last %zu transactions", tail);
+					goto retry;
+				}
+			}
 			queued_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
 			goto skip;
 
@@ -1509,6 +1636,7 @@ static void ftdi_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32
 
 	size_t i = swd_cmd_queue_length++;
 	swd_cmd_queue[i].cmd = cmd | SWD_CMD_START | SWD_CMD_PARK;
+	swd_cmd_queue[i].ap_delay_clk = ap_delay_clk;
 
 	mpsse_clock_data_out(mpsse_ctx, &swd_cmd_queue[i].cmd, 0, 8, SWD_MODE);
 
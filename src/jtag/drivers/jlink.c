@@ -40,6 +40,7 @@
 #include <jtag/commands.h>
 #include <jtag/drivers/jtag_usb_common.h>
 #include <target/cortex_m.h>
+#include <helper/time_support.h>
 
 #include <libjaylink/libjaylink.h>
 
@@ -59,9 +60,12 @@ static enum jaylink_target_interface iface = JAYLINK_TIF_JTAG;
 static bool trace_enabled;
 
 #define JLINK_MAX_SPEED			12000
-#define JLINK_TAP_BUFFER_SIZE	2048
+/* jaylink_jtag_io() and jaylink_swd_io() transfer at most 65535 bits */
+#define JLINK_TAP_BUFFER_SIZE	8191
+/* Buffer size for devices which can't report their free memory */
+#define JLINK_DEFAULT_TAP_BUFFER_SIZE	2048
 
-static unsigned int swd_buffer_size = JLINK_TAP_BUFFER_SIZE;
+static unsigned int tap_buffer_size = JLINK_DEFAULT_TAP_BUFFER_SIZE;
 
 /* Maximum SWO frequency deviation. */
 #define SWO_MAX_FREQ_DEV	0.03
@@ -459,11 +463,12 @@ static int jlink_register(void)
 }
 
 /*
- * Adjust the SWD transaction buffer size depending on the free device internal
- * memory. This ensures that the SWD transactions sent to the device do not
- * exceed the internal memory of the device.
+ * Adjust the JTAG/SWD transaction buffer size depending on the free device
+ * internal memory. This ensures that the transactions sent to the device do
+ * not exceed the internal memory of the device, while using as much of it as
+ * possible to keep the number of USB round trips low.
  */
-static bool adjust_swd_buffer_size(void)
+static bool adjust_tap_buffer_size(void)
 {
 	int ret;
 	uint32_t tmp;
@@ -486,10 +491,10 @@ static bool adjust_swd_buffer_size(void)
 
 	tmp = MIN(JLINK_TAP_BUFFER_SIZE, (tmp - 16) / 2);
 
-	if (tmp != swd_buffer_size) {
-		swd_buffer_size = tmp;
-		LOG_DEBUG("Adjusted SWD transaction buffer size to %u bytes.",
-			swd_buffer_size);
+	if (tmp != tap_buffer_size) {
+		tap_buffer_size = tmp;
+		LOG_DEBUG("Adjusted transaction buffer size to %u bytes.",
+			tap_buffer_size);
 	}
 
 	return true;
@@ -740,18 +745,16 @@ static int jlink_init(void)
 			jtag_command_version = JAYLINK_JTAG_VERSION_3;
 	}
 
-	if (iface == JAYLINK_TIF_SWD) {
-		/*
-		 * Adjust the SWD transaction buffer size in case there is already
-		 * allocated memory on the device. This happens for example if the
-		 * memory for SWO capturing is still allocated because the software
-		 * which used the device before has not been shut down properly.
-		 */
-		if (!adjust_swd_buffer_size()) {
-			jaylink_close(devh);
-			jaylink_exit(jayctx);
-			return ERROR_JTAG_INIT_FAILED;
-		}
+	/*
+	 * Adjust the transaction buffer size to the device. This also accounts
+	 * for already allocated memory on the device. This happens for example
+	 * if the memory for SWO capturing is still allocated because the
+	 * software which used the device before has not been shut down properly.
+	 */
+	if (!adjust_tap_buffer_size()) {
+		jaylink_close(devh);
+		jaylink_exit(jayctx);
+		return ERROR_JTAG_INIT_FAILED;
 	}
 
 	if (jaylink_has_cap(caps, JAYLINK_DEV_CAP_READ_CONFIG)) {
@@ -1343,10 +1346,10 @@ static int config_trace(bool enabled, enum tpiu_pin_protocol pin_protocol,
 
 	if (!enabled) {
 		/*
-		 * Adjust the SWD transaction buffer size as stopping SWO capturing
+		 * Adjust the transaction buffer size as stopping SWO capturing
 		 * deallocates device internal memory.
 		 */
-		if (!adjust_swd_buffer_size())
+		if (!adjust_tap_buffer_size())
 			return ERROR_FAIL;
 
 		return ERROR_OK;
@@ -1424,10 +1427,10 @@ static int config_trace(bool enabled, enum tpiu_pin_protocol pin_protocol,
 		buffer_size);
 
 	/*
-	 * Adjust the SWD transaction buffer size as starting SWO capturing
+	 * Adjust the transaction buffer size as starting SWO capturing
 	 * allocates device internal memory.
 	 */
-	if (!adjust_swd_buffer_size())
+	if (!adjust_tap_buffer_size())
 		return ERROR_FAIL;
 
 	return ERROR_OK;
@@ -2007,17 +2010,18 @@ struct pending_scan_result {
 	unsigned buffer_offset;
 };
 
-#define MAX_PENDING_SCAN_RESULTS 256
+#define MAX_PENDING_SCAN_RESULTS 1024
 
 static int pending_scan_results_length;
 static struct pending_scan_result pending_scan_results_buffer[MAX_PENDING_SCAN_RESULTS];
 
 static void jlink_tap_init(void)
 {
+	/* Only the part used by the last transaction needs to be cleared */
+	memset(tms_buffer, 0, DIV_ROUND_UP(tap_length, 8));
+	memset(tdi_buffer, 0, DIV_ROUND_UP(tap_length, 8));
 	tap_length = 0;
 	pending_scan_results_length = 0;
-	memset(tms_buffer, 0, sizeof(tms_buffer));
-	memset(tdi_buffer, 0, sizeof(tdi_buffer));
 }
 
 static void jlink_clock_data(const uint8_t *out, unsigned out_offset,
@@ -2026,13 +2030,13 @@ static void jlink_clock_data(const uint8_t *out, unsigned out_offset,
 			     unsigned length)
 {
 	do {
-		unsigned available_length = JLINK_TAP_BUFFER_SIZE - tap_length / 8;
+		unsigned available_length = tap_buffer_size * 8 - tap_length;
 
 		if (!available_length ||
 		    (in && pending_scan_results_length == MAX_PENDING_SCAN_RESULTS)) {
 			if (jlink_flush() != ERROR_OK)
 				return;
-			available_length = JLINK_TAP_BUFFER_SIZE;
+			available_length = tap_buffer_size * 8;
 		}
 
 		struct pending_scan_result *pending_scan_result =
@@ -2066,6 +2070,7 @@ static int jlink_flush(void)
 {
 	int i;
 	int ret;
+	struct duration bench;
 
 	if (!tap_length)
 		return ERROR_OK;
@@ -2073,8 +2078,16 @@ static int jlink_flush(void)
 	jlink_last_state = jtag_debug_state_machine(tms_buffer, tdi_buffer,
 		tap_length, jlink_last_state);
 
+	duration_start(&bench);
 	ret = jaylink_jtag_io(devh, tms_buffer, tdi_buffer, tdo_buffer,
 		tap_length, jtag_command_version);
+	duration_measure(&bench);
+
+	/* a short transfer may complete within the timer resolution */
+	float elapsed = duration_elapsed(&bench);
+	LOG_DEBUG_IO("jaylink_jtag_io(): %u bits, %u scan results in %.3f ms, %.1f kbit/s.",
+		tap_length, pending_scan_results_length, elapsed * 1000,
+		elapsed > 0 ? tap_length / elapsed / 1000 : 0);
 
 	if (ret != JAYLINK_OK) {
 		LOG_ERROR("jaylink_jtag_io() failed: %s.", jaylink_strerror(ret));
@@ -2221,7 +2234,7 @@ skip:
 static void jlink_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
 {
 	uint8_t data_parity_trn[DIV_ROUND_UP(32 + 1, 8)];
-	if (tap_length + 46 + 8 + ap_delay_clk >= swd_buffer_size * 8 ||
+	if (tap_length + 46 + 8 + ap_delay_clk >= tap_buffer_size * 8 ||
 	    pending_scan_results_length == MAX_PENDING_SCAN_RESULTS) {
 		/* Not enough room in the queue. Run the queue. */
 		queued_retval = jlink_swd_run_queue();
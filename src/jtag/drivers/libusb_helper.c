@@ -271,6 +271,17 @@ int jtag_libusb_bulk_read(struct libusb_device_handle *dev, int ep, char *bytes,
 	return ERROR_OK;
 }
 
+int jtag_libusb_handle_events_completed(int *completed)
+{
+	int ret = libusb_handle_events_completed(jtag_libusb_context, completed);
+	if (ret != LIBUSB_SUCCESS && ret != LIBUSB_ERROR_INTERRUPTED) {
+		LOG_ERROR("libusb_handle_events error: %s", libusb_error_name(ret));
+		return jtag_libusb_error(ret);
+	}
+
+	return ERROR_OK;
+}
+
 int jtag_libusb_set_configuration(struct libusb_device_handle *devh,
 		int configuration)
 {
@@ -41,6 +41,14 @@ int jtag_libusb_bulk_read(struct libusb_device_handle *dev, int ep,
 		char *bytes, int size, int timeout, int *transferred);
 int jtag_libusb_set_configuration(struct libusb_device_handle *devh,
 		int configuration);
+/**
+ * Process events for asynchronous transfers submitted on a device opened
+ * with jtag_libusb_open(), until @a completed becomes non-zero or a
+ * transfer callback runs.
+ * @returns ERROR_OK, or the jtag_libusb_error() mapping of the libusb
+ * error (interruptions are not an error).
+ */
+int jtag_libusb_handle_events_completed(int *completed);
 /**
  * Find the first interface optionally matching class, subclass and
  * protocol and claim it.
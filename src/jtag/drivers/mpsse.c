@@ -621,6 +621,44 @@ void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_
 	}
 }
 
+void mpsse_clock_idle(struct mpsse_ctx *ctx, unsigned length, uint8_t mode)
+{
+	LOG_DEBUG_IO("%d cycles", length);
+
+	if (ctx->retval != ERROR_OK) {
+		LOG_DEBUG_IO("Ignoring command due to previous error");
+		return;
+	}
+
+	/* The FT2232C has no clock-only commands; shifting out zeros on TDI leaves
+	 * TMS alone just as well, it only costs more bytes. */
+	if (!mpsse_is_high_speed(ctx)) {
+		mpsse_clock_data(ctx, NULL, 0, NULL, 0, length, mode);
+		return;
+	}
+
+	while (length > 0) {
+		if (buffer_write_space(ctx) < 3)
+			ctx->retval = mpsse_flush(ctx);
+
+		if (length < 8) {
+			/* Clock for n bits with no data transfer */
+			buffer_write_byte(ctx, 0x8e);
+			buffer_write_byte(ctx, length - 1);
+			length = 0;
+		} else {
+			/* Clock for n x 8 bits with no data transfer */
+			unsigned this_bytes = length / 8;
+			if (this_bytes > 65536)
+				this_bytes = 65536;
+			buffer_write_byte(ctx, 0x8f);
+			buffer_write_byte(ctx, (this_bytes - 1) & 0xff);
+			buffer_write_byte(ctx, (this_bytes - 1) >> 8);
+			length -= this_bytes * 8;
+		}
+	}
+}
+
 void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir)
 {
 	LOG_DEBUG_IO("-");
@@ -58,6 +58,8 @@ void mpsse_clock_tms_cs_out(struct mpsse_ctx *ctx, const uint8_t *out, unsigned
 			   unsigned length, bool tdi, uint8_t mode);
 void mpsse_clock_tms_cs(struct mpsse_ctx *ctx, const uint8_t *out, unsigned out_offset, uint8_t *in,
 		       unsigned in_offset, unsigned length, bool tdi, uint8_t mode);
+/* Clock TCK without changing TMS or TDI, e.g. for Run-Test/Idle cycles after TMS was left low */
+void mpsse_clock_idle(struct mpsse_ctx *ctx, unsigned length, uint8_t mode);
 void mpsse_set_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir);
 void mpsse_set_data_bits_high_byte(struct mpsse_ctx *ctx, uint8_t data, uint8_t dir);
 void mpsse_read_data_bits_low_byte(struct mpsse_ctx *ctx, uint8_t *data);
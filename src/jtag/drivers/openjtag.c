@@ -45,6 +45,7 @@
 
 #include <jtag/interface.h>
 #include <jtag/commands.h>
+#include <helper/time_support.h>
 #include "libusb_helper.h"
 
 static enum {
@@ -99,11 +100,14 @@ struct openjtag_scan_result {
 	uint32_t bits;          /* Length in bits*/
 	struct scan_command *command;   /* Corresponding scan command */
 	uint8_t *buffer;
+	uint32_t offset;	/* First byte of this part of the scan in buffer */
+	bool last;	/* Last part of the scan */
 };
 
 /* USB RX/TX buffers */
 static int usb_tx_buf_offs;
 static uint8_t usb_tx_buf[OPENJTAG_BUFFER_SIZE];
+static uint32_t usb_rx_buf_expected;
 static uint32_t usb_rx_buf_len;
 static uint8_t usb_rx_buf[OPENJTAG_BUFFER_SIZE];
 
@@ -485,6 +489,7 @@ static int openjtag_init(void)
 	int ret;
 
 	usb_tx_buf_offs = 0;
+	usb_rx_buf_expected = 0;
 	usb_rx_buf_len = 0;
 	openjtag_scan_result_count = 0;
 
@@ -538,19 +543,42 @@ static int openjtag_quit(void)
 	}
 }
 
-static void openjtag_write_tap_buffer(void)
+static int openjtag_write_tap_buffer(void)
 {
 	uint32_t written;
+	struct duration bench;
+	int retval;
+
+	duration_start(&bench);
+
+	retval = openjtag_buf_write(usb_tx_buf, usb_tx_buf_offs, &written);
 
-	openjtag_buf_write(usb_tx_buf, usb_tx_buf_offs, &written);
-	openjtag_buf_read(usb_rx_buf, usb_tx_buf_offs, &usb_rx_buf_len);
+	/* Only shifted data comes back, one byte per scan byte. Buffers
+	 * holding nothing but state moves and idle clocks need no read. */
+	usb_rx_buf_len = 0;
+	if (retval == ERROR_OK && usb_rx_buf_expected)
+		retval = openjtag_buf_read(usb_rx_buf, usb_rx_buf_expected, &usb_rx_buf_len);
+
+	duration_measure(&bench);
+	LOG_DEBUG_IO("flushed %d of %d bytes, read %" PRIu32 " of %" PRIu32 " bytes, %d scan results in %.3f ms",
+		usb_tx_buf_offs, OPENJTAG_BUFFER_SIZE, usb_rx_buf_len, usb_rx_buf_expected,
+		openjtag_scan_result_count, duration_elapsed(&bench) * 1000);
+
+	if (retval == ERROR_OK && usb_rx_buf_len != usb_rx_buf_expected) {
+		LOG_ERROR("expected %" PRIu32 " bytes of scan data, got %" PRIu32,
+			usb_rx_buf_expected, usb_rx_buf_len);
+		retval = ERROR_JTAG_DEVICE_ERROR;
+	}
 
 	usb_tx_buf_offs = 0;
+	usb_rx_buf_expected = 0;
+
+	return retval;
 }
 
 static int openjtag_execute_tap_queue(void)
 {
-	openjtag_write_tap_buffer();
+	int retval = openjtag_write_tap_buffer();
 
 	int res_count = 0;
 
@@ -566,7 +594,7 @@ static int openjtag_execute_tap_queue(void)
 			/* get sent bits */
 			len = openjtag_scan_result_buffer[res_count].bits;
 
-			count = 0;
+			count = openjtag_scan_result_buffer[res_count].offset;
 
 			uint8_t *buffer = openjtag_scan_result_buffer[res_count].buffer;
 
@@ -586,13 +614,17 @@ static int openjtag_execute_tap_queue(void)
 			}
 
 #ifdef _DEBUG_USB_COMMS_
-			openjtag_debug_buffer(buffer,
+			openjtag_debug_buffer(buffer + openjtag_scan_result_buffer[res_count].offset,
 				DIV_ROUND_UP(openjtag_scan_result_buffer[res_count].bits, 8), DEBUG_TYPE_OCD_READ);
 #endif
-			jtag_read_buffer(buffer, openjtag_scan_result_buffer[res_count].command);
+			if (openjtag_scan_result_buffer[res_count].last) {
+				if (retval == ERROR_OK)
+					retval = jtag_read_buffer(buffer,
+							openjtag_scan_result_buffer[res_count].command);
 
-			if (openjtag_scan_result_buffer[res_count].buffer)
-				free(openjtag_scan_result_buffer[res_count].buffer);
+				if (openjtag_scan_result_buffer[res_count].buffer)
+					free(openjtag_scan_result_buffer[res_count].buffer);
+			}
 
 			res_count++;
 		}
@@ -600,7 +632,7 @@ static int openjtag_execute_tap_queue(void)
 
 	openjtag_scan_result_count = 0;
 
-	return ERROR_OK;
+	return retval;
 }
 
 static void openjtag_add_byte(char buf)
@@ -618,23 +650,31 @@ static void openjtag_add_byte(char buf)
 
 static void openjtag_add_scan(uint8_t *buffer, int length, struct scan_command *scan_cmd)
 {
-
-	/* Ensure space to send long chains */
-	/* We add two byte for each eight (or less) bits, one for command, one for data */
-	if (usb_tx_buf_offs + (DIV_ROUND_UP(length, 8) * 2) >= OPENJTAG_BUFFER_SIZE) {
-		LOG_DEBUG_IO("Forcing execute_tap_queue from scan");
-		LOG_DEBUG_IO("TX Buff offs=%d len=%d", usb_tx_buf_offs, DIV_ROUND_UP(length, 8) * 2);
-		openjtag_execute_tap_queue();
-	}
-
-	openjtag_scan_result_buffer[openjtag_scan_result_count].bits = length;
-	openjtag_scan_result_buffer[openjtag_scan_result_count].command = scan_cmd;
-	openjtag_scan_result_buffer[openjtag_scan_result_count].buffer = buffer;
-
+	struct openjtag_scan_result *result = NULL;
 	uint8_t command;
 	uint8_t bits;
 	int count = 0;
+
+	/* We add two byte for each eight (or less) bits, one for command, one
+	 * for data. Rather than flushing a partially filled buffer before a
+	 * long chain, fill it up and continue the scan in the next one. */
 	while (length) {
+		if (usb_tx_buf_offs + 2 > OPENJTAG_BUFFER_SIZE ||
+				openjtag_scan_result_count == OPENJTAG_MAX_PENDING_RESULTS) {
+			LOG_DEBUG_IO("Forcing execute_tap_queue from scan");
+			LOG_DEBUG_IO("TX Buff offs=%d len=%d", usb_tx_buf_offs, DIV_ROUND_UP(length, 8) * 2);
+			openjtag_execute_tap_queue();
+			result = NULL;
+		}
+
+		if (!result) {
+			result = &openjtag_scan_result_buffer[openjtag_scan_result_count++];
+			result->bits = 0;
+			result->command = scan_cmd;
+			result->buffer = buffer;
+			result->offset = count;
+			result->last = false;
+		}
 
 		/* write command */
 		command = 6;
@@ -647,21 +687,24 @@ static void openjtag_add_scan(uint8_t *buffer, int length, struct scan_command *
 			/* bits to transfer */
 			bits = (length - 1);
 			command |= bits << 5;
+			result->bits += bits + 1;
 			length = 0;
 		} else {
 			/* whole byte */
 
 			/* bits to transfer */
 			command |= (7 << 5);
+			result->bits += 8;
 			length -= 8;
 		}
 
 		openjtag_add_byte(command);
 		openjtag_add_byte(buffer[count]);
 		count++;
-	}
 
-	openjtag_scan_result_count++;
+		result->last = !length;
+		usb_rx_buf_expected++;
+	}
 }
 
 static void openjtag_execute_reset(struct jtag_command *cmd)
@@ -96,6 +96,14 @@
  */
 #define BUF_LEN 4096
 
+/*
+ * Maximum number of TDO bytes requested but not yet read back. The USB
+ * Blaster read FIFO holds 384 bytes; one more byte-shift packet
+ * (MAX_PACKET_SIZE) may be requested on top of this limit, see
+ * ublast_queue_read().
+ */
+#define MAX_PENDING_READ_BYTES 256
+
 /* USB-Blaster II specific command */
 #define CMD_COPY_TDO_BUFFER	0x5F
 
@@ -106,6 +114,17 @@ enum gpio_steer {
 	TRST,
 };
 
+struct ublast_pending_read {
+	uint8_t *buf;
+	int nb;
+	bool bitbang;
+};
+
+struct ublast_pending_scan {
+	struct scan_command *cmd;
+	uint8_t *buf;
+};
+
 struct ublast_info {
 	enum gpio_steer pin6;
 	enum gpio_steer pin8;
@@ -116,6 +135,15 @@ struct ublast_info {
 	uint8_t buf[BUF_LEN];
 	int bufidx;
 
+	/* TDO reads requested from the dongle, fetched by ublast_complete_reads() */
+	struct ublast_pending_read reads[MAX_PENDING_READ_BYTES];
+	int nb_reads;
+	int read_bytes;
+	int read_retval;
+	/* Scans waiting for their TDO reads to complete */
+	struct ublast_pending_scan scans[MAX_PENDING_READ_BYTES];
+	int nb_scans;
+
 	char *lowlevel_name;
 	struct ublast_lowlevel *drv;
 	char *ublast_device_desc;
@@ -191,6 +219,8 @@ static int ublast_buf_write(uint8_t *buf, int size, uint32_t *bytes_written)
 	return ret;
 }
 
+static int ublast_complete_reads(void);
+
 static int nb_buf_remaining(void)
 {
 	return BUF_LEN - info.bufidx;
@@ -208,6 +238,17 @@ static void ublast_flush_buffer(void)
 	info.bufidx = 0;
 }
 
+/*
+ * Send everything queued so far to the dongle and complete the pending TDO
+ * reads, for commands that must not overtake the preceding scans.
+ */
+static void ublast_sync(void)
+{
+	int ret = ublast_complete_reads();
+	if (info.read_retval == ERROR_OK)
+		info.read_retval = ret;
+}
+
 /*
  * Actually, the USB-Blaster offers a byte-shift mode to transmit up to 504 data
  * bits (bidirectional) in a single USB packet. A header byte has to be sent as
@@ -320,6 +361,7 @@ static void ublast_reset(int trst, int srst)
 {
 	uint8_t out_value;
 
+	ublast_sync();
 	info.trst_asserted = trst;
 	info.srst_asserted = srst;
 	out_value = ublast_build_out(SCAN_OUT);
@@ -523,70 +565,93 @@ static void ublast_state_move(tap_state_t state, int skip)
 }
 
 /**
- * ublast_read_byteshifted_tdos - read TDO of byteshift writes
+ * ublast_queue_read - register a pending TDO read
  * @buf: the buffer to store the bits
- * @nb_bits: the number of bits
+ * @nb: the number of bytes the USB Blaster will send back
+ * @bitbang: true if each byte holds one TDO bit (bitbang mode), false if it
+ *           holds eight (byteshift mode)
  *
- * Reads back from USB Blaster TDO bits, triggered by a 'byteshift write', ie. eight
- * bits per received byte from USB interface, and store them in buffer.
- *
- * As the USB blaster stores the TDO bits in LSB (ie. first bit in (byte0,
- * bit0), second bit in (byte0, bit1), ...), which is what we want to return,
- * simply read bytes from USB interface and store them.
- *
- * Returns ERROR_OK if OK, ERROR_xxx if a read error occured
+ * The read is not performed immediately: the TDO bytes of a whole queue are
+ * fetched in a single go by ublast_complete_reads(), so that each read
+ * request doesn't cost a USB round trip. If the outstanding reads would
+ * exceed what the USB Blaster can buffer, the pending ones are completed
+ * first; the request just queued stays in the dongle and is read next time,
+ * as it is at most MAX_PACKET_SIZE bytes.
  */
-static int ublast_read_byteshifted_tdos(uint8_t *buf, int nb_bytes)
+static void ublast_queue_read(uint8_t *buf, int nb, bool bitbang)
 {
-	unsigned int retlen;
-	int ret = ERROR_OK;
+	LOG_DEBUG_IO("%s(buf=%p, nb=%d, bitbang=%d)", __func__, buf, nb, bitbang);
 
-	LOG_DEBUG_IO("%s(buf=%p, num_bits=%d)", __func__, buf, nb_bytes * 8);
-	ublast_flush_buffer();
-	while (ret == ERROR_OK && nb_bytes > 0) {
-		ret = ublast_buf_read(buf, nb_bytes, &retlen);
-		nb_bytes -= retlen;
+	if (info.read_bytes + nb > MAX_PENDING_READ_BYTES) {
+		int ret = ublast_complete_reads();
+		if (info.read_retval == ERROR_OK)
+			info.read_retval = ret;
 	}
-	return ret;
+
+	info.reads[info.nb_reads].buf = buf;
+	info.reads[info.nb_reads].nb = nb;
+	info.reads[info.nb_reads].bitbang = bitbang;
+	info.nb_reads++;
+	info.read_bytes += nb;
 }
 
 /**
- * ublast_read_bitbang_tdos - read TDO of bitbang writes
- * @buf: the buffer to store the bits
- * @nb_bits: the number of bits
+ * ublast_complete_reads - read back all pending TDOs
  *
- * Reads back from USB Blaster TDO bits, triggered by a 'bitbang write', ie. one
- * bit per received byte from USB interface, and store them in buffer, where :
- *  - first bit is stored in byte0, bit0 (LSB)
- *  - second bit is stored in byte0, bit 1
- *  ...
- *  - eight bit is sotred in byte0, bit 7
- *  - ninth bit is sotred in byte1, bit 0
- *  - etc ...
+ * Flushes the write buffer, reads back the TDO bytes of all pending read
+ * requests, and stores them:
+ *  - for a 'byteshift write', eight bits per received byte, which the USB
+ *    Blaster already sends LSB first, as we want to return them
+ *  - for a 'bitbang write', one bit per received byte, where first bit is
+ *    stored in byte0, bit0 (LSB), ..., ninth bit in byte1, bit 0, etc ...
+ * Then the scans waiting for these TDOs are completed.
  *
  * Returns ERROR_OK if OK, ERROR_xxx if a read error occured
  */
-static int ublast_read_bitbang_tdos(uint8_t *buf, int nb_bits)
+static int ublast_complete_reads(void)
 {
-	int nb1 = nb_bits;
-	int i, ret = ERROR_OK;
+	uint8_t tdos[MAX_PENDING_READ_BYTES];
 	unsigned int retlen;
-	uint8_t tmp[8];
+	int nb_bytes = info.read_bytes;
+	int ret = ERROR_OK;
 
-	LOG_DEBUG_IO("%s(buf=%p, num_bits=%d)", __func__, buf, nb_bits);
+	LOG_DEBUG_IO("%s(reads=%d, bytes=%d, scans=%d)", __func__, info.nb_reads,
+		info.read_bytes, info.nb_scans);
 
 	/*
-	 * Ensure all previous bitbang writes were issued to the dongle, so that
-	 * it returns back the read values.
+	 * Ensure all previous writes were issued to the dongle, so that it
+	 * returns back the read values.
 	 */
 	ublast_flush_buffer();
+	while (ret == ERROR_OK && nb_bytes > 0) {
+		ret = ublast_buf_read(tdos + info.read_bytes - nb_bytes, nb_bytes, &retlen);
+		nb_bytes -= retlen;
+	}
+
+	uint8_t *tdo = tdos;
+	for (int i = 0; ret == ERROR_OK && i < info.nb_reads; i++) {
+		struct ublast_pending_read *rd = &info.reads[i];
+		if (rd->bitbang) {
+			for (int j = 0; j < rd->nb; j++)
+				if (tdo[j] & READ_TDO)
+					*rd->buf |= (1 << j);
+				else
+					*rd->buf &= ~(1 << j);
+		} else {
+			memcpy(rd->buf, tdo, rd->nb);
+		}
+		tdo += rd->nb;
+	}
+	info.nb_reads = 0;
+	info.read_bytes = 0;
+
+	for (int i = 0; i < info.nb_scans; i++) {
+		if (ret == ERROR_OK)
+			ret = jtag_read_buffer(info.scans[i].buf, info.scans[i].cmd);
+		free(info.scans[i].buf);
+	}
+	info.nb_scans = 0;
 
-	ret = ublast_buf_read(tmp, nb1, &retlen);
-	for (i = 0; ret == ERROR_OK && i < nb1; i++)
-		if (tmp[i] & READ_TDO)
-			*buf |= (1 << i);
-		else
-			*buf &= ~(1 << i);
 	return ret;
 }
 
@@ -600,8 +665,9 @@ static int ublast_read_bitbang_tdos(uint8_t *buf, int nb_bits)
  * As a side effect, the last TDI bit is sent along a TMS=1, and triggers a JTAG
  * TAP state shift if input bits were non NULL.
  *
- * In order to not saturate the USB Blaster queues, this method reads back TDO
- * if the scan type requests it, and stores them back in bits.
+ * If the scan type requests it, the TDO read back is registered with
+ * ublast_queue_read(), and will be stored back in bits once
+ * ublast_complete_reads() runs.
  *
  * As a side note, the state of TCK when entering this function *must* be
  * low. This is because byteshift mode outputs TDI on rising TCK and reads TDO
@@ -614,7 +680,6 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 	int nb8 = nb_bits / 8;
 	int nb1 = nb_bits % 8;
 	int nbfree_in_packet, i, trans = 0, read_tdos;
-	uint8_t *tdos = calloc(1, nb_bits / 8 + 1);
 	static uint8_t byte0[BUF_LEN];
 
 	/*
@@ -631,7 +696,7 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 		nb1 = 8;
 	}
 
-	read_tdos = (scan == SCAN_IN || scan == SCAN_IO);
+	read_tdos = bits && (scan == SCAN_IN || scan == SCAN_IO);
 	for (i = 0; i < nb8; i += trans) {
 		/*
 		 * Calculate number of bytes to fill USB packet of size MAX_PACKET_SIZE
@@ -656,7 +721,7 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 		if (read_tdos) {
 			if (info.flags & COPY_TDO_BUFFER)
 				ublast_queue_byte(CMD_COPY_TDO_BUFFER);
-			ublast_read_byteshifted_tdos(&tdos[i], trans);
+			ublast_queue_read(&bits[i], trans, false);
 		}
 	}
 
@@ -673,13 +738,9 @@ static void ublast_queue_tdi(uint8_t *bits, int nb_bits, enum scan_type scan)
 	if (nb1 && read_tdos) {
 		if (info.flags & COPY_TDO_BUFFER)
 			ublast_queue_byte(CMD_COPY_TDO_BUFFER);
-		ublast_read_bitbang_tdos(&tdos[nb8], nb1);
+		ublast_queue_read(&bits[nb8], nb1, true);
 	}
 
-	if (bits)
-		memcpy(bits, tdos, DIV_ROUND_UP(nb_bits, 8));
-	free(tdos);
-
 	/*
 	 * Ensure clock is in lower state
 	 */
@@ -705,16 +766,14 @@ static void ublast_stableclocks(int cycles)
  * ublast_scan - launches a DR-scan or IR-scan
  * @cmd: the command to launch
  *
- * Launch a JTAG IR-scan or DR-scan
- *
- * Returns ERROR_OK if OK, ERROR_xxx if a read/write error occured.
+ * Launch a JTAG IR-scan or DR-scan. If TDO is read back, the scan is completed
+ * by ublast_complete_reads(), otherwise right away.
  */
-static int ublast_scan(struct scan_command *cmd)
+static void ublast_scan(struct scan_command *cmd)
 {
 	int scan_bits;
 	uint8_t *buf = NULL;
 	enum scan_type type;
-	int ret = ERROR_OK;
 	static const char * const type2str[] = { "", "SCAN_IN", "SCAN_OUT", "SCAN_IO" };
 	char *log_buf = NULL;
 
@@ -735,21 +794,25 @@ static int ublast_scan(struct scan_command *cmd)
 
 	ublast_queue_tdi(buf, scan_bits, type);
 
-	ret = jtag_read_buffer(buf, cmd);
-	if (buf)
+	if (type == SCAN_OUT) {
 		free(buf);
+	} else {
+		info.scans[info.nb_scans].cmd = cmd;
+		info.scans[info.nb_scans].buf = buf;
+		info.nb_scans++;
+	}
 	/*
 	 * ublast_queue_tdi sends the last bit with TMS=1. We are therefore
 	 * already in Exit1-DR/IR and have to skip the first step on our way
 	 * to end_state.
 	 */
 	ublast_state_move(cmd->end_state, 1);
-	return ret;
 }
 
 static void ublast_usleep(int us)
 {
 	LOG_DEBUG_IO("%s(us=%d)",  __func__, us);
+	ublast_sync();
 	jtag_sleep(us);
 }
 
@@ -814,7 +877,7 @@ static int ublast_execute_queue(void)
 			ublast_usleep(cmd->cmd.sleep->us);
 			break;
 		case JTAG_SCAN:
-			ret = ublast_scan(cmd->cmd.scan);
+			ublast_scan(cmd->cmd.scan);
 			break;
 		default:
 			LOG_ERROR("BUG: unknown JTAG command type 0x%X",
@@ -824,7 +887,12 @@ static int ublast_execute_queue(void)
 		}
 	}
 
-	ublast_flush_buffer();
+	int retval = ublast_complete_reads();
+	if (ret == ERROR_OK)
+		ret = info.read_retval;
+	if (ret == ERROR_OK)
+		ret = retval;
+	info.read_retval = ERROR_OK;
 	return ret;
 }
 
@@ -27,6 +27,7 @@
 #include <jtag/interface.h>
 #include <jtag/commands.h>
 #include <jtag/swd.h>
+#include <helper/time_support.h>
 #include <libusb.h>
 
 #include "versaloon/versaloon_include.h"
@@ -331,8 +332,11 @@ static int vsllink_init(void)
 		vsllink_swd_switch_seq(JTAG_TO_SWD);
 
 	} else {
-		/* malloc buffer size for tap */
-		tap_buffer_size = versaloon_interface.usb_setting.buf_size / 2 - 32;
+		/* malloc buffer size for tap: the whole USB buffer except the
+		 * versaloon and USB_TO_JTAG_RAW headers (3 + 3), the bit count
+		 * (4) and the command headroom checked by
+		 * usbtoxxx_ensure_buffer_size() (6), split into TDI and TMS */
+		tap_buffer_size = (versaloon_interface.usb_setting.buf_size - 18) / 2;
 		vsllink_free_buffer();
 		tdi_buffer = malloc(tap_buffer_size);
 		tdo_buffer = malloc(tap_buffer_size);
@@ -639,14 +643,23 @@ static int vsllink_jtag_execute(void)
 {
 	int i;
 	int result;
+	struct duration bench;
 
 	if (tap_length <= 0)
 		return ERROR_OK;
 
+	duration_start(&bench);
 	versaloon_interface.adaptors.jtag_raw.execute(0, tdi_buffer, tms_buffer,
 		tdo_buffer, tap_length);
 
 	result = versaloon_interface.adaptors.peripheral_commit();
+	duration_measure(&bench);
+
+	/* a short transfer may complete within the timer resolution */
+	float elapsed = duration_elapsed(&bench);
+	LOG_DEBUG_IO("JTAG raw: %d of %d bits, %d scan results in %.3f ms, %.1f kbit/s",
+		tap_length, tap_buffer_size * 8, pending_scan_results_length,
+		elapsed * 1000, elapsed > 0 ? tap_length / elapsed / 1000 : 0);
 
 	if (result == ERROR_OK) {
 		for (i = 0; i < pending_scan_results_length; i++) {
@@ -42,6 +42,7 @@
 #endif
 
 #include <helper/time_support.h>
+#include <helper/fileio.h>
 #include "transport/transport.h"
 
 /**
@@ -219,6 +220,127 @@ static int Jim_Command_drscan(Jim_Interp *interp, int argc, Jim_Obj *const *args
 	return JIM_OK;
 }
 
+/* Binary flavour of drscan: each scan is a list of "num_bits value"
+ * pairs whose values are raw byte strings (least significant bit first),
+ * and captured data is returned the same way. All scans of one call go
+ * out with a single jtag_execute_queue().
+ */
+static int Jim_Command_drscan_binary(Jim_Interp *interp, int argc, Jim_Obj *const *args)
+{
+	struct jtag_tap *tap;
+	tap_state_t endstate = TAP_IDLE;
+	int first = 2;
+
+	/* args[1] = device
+	 * optionally "-endstate" statename
+	 * args[first..] = { num_bits value [num_bits value]* }, one list per scan
+	 */
+	if (argc < 3) {
+		Jim_WrongNumArgs(interp, 1, args, "wrong arguments");
+		return JIM_ERR;
+	}
+
+	script_debug(interp, argc, args);
+
+	tap = jtag_tap_by_jim_obj(interp, args[1]);
+	if (tap == NULL)
+		return JIM_ERR;
+
+	if (argc > 4 && strcmp("-endstate", Jim_GetString(args[2], NULL)) == 0) {
+		const char *cp = Jim_GetString(args[3], NULL);
+		endstate = tap_state_by_name(cp);
+		if (endstate < 0) {
+			Jim_SetResultFormatted(interp, "endstate: %s invalid", cp);
+			return JIM_ERR;
+		}
+		if (!scan_is_safe(endstate))
+			LOG_WARNING("drscan_binary with unsafe endstate \"%s\"", cp);
+		first = 4;
+	}
+
+	/* size everything up front so one allocation holds all fields */
+	int num_fields = 0;
+	size_t num_bytes = 0;
+	for (int i = first; i < argc; i++) {
+		int len = Jim_ListLength(interp, args[i]);
+		if (len <= 0 || (len % 2) != 0) {
+			Jim_SetResultString(interp,
+				"drscan_binary: each scan must be a list of num_bits value pairs", -1);
+			return JIM_ERR;
+		}
+		for (int j = 0; j < len; j += 2) {
+			long bits;
+			if (Jim_GetLong(interp, Jim_ListGetIndex(interp, args[i], j), &bits) != JIM_OK)
+				return JIM_ERR;
+			if (bits <= 0) {
+				Jim_SetResultString(interp, "drscan_binary: invalid field size", -1);
+				return JIM_ERR;
+			}
+			num_bytes += DIV_ROUND_UP(bits, 8);
+			num_fields++;
+		}
+	}
+
+	struct scan_field *fields = calloc(num_fields, sizeof(*fields));
+	uint8_t *data = calloc(1, num_bytes);
+	if (fields == NULL || data == NULL) {
+		free(fields);
+		free(data);
+		Jim_SetResultString(interp, "drscan_binary: out of memory", -1);
+		return JIM_ERR;
+	}
+
+	/* in and out share a buffer: out values are copied when queued */
+	int f = 0;
+	uint8_t *p = data;
+	for (int i = first; i < argc; i++) {
+		int len = Jim_ListLength(interp, args[i]);
+		int scan_first = f;
+		for (int j = 0; j < len; j += 2) {
+			long bits;
+			int value_len;
+			Jim_GetLong(interp, Jim_ListGetIndex(interp, args[i], j), &bits);
+			const char *value = Jim_GetString(Jim_ListGetIndex(interp, args[i], j + 1),
+					&value_len);
+			int bytes = DIV_ROUND_UP(bits, 8);
+
+			memcpy(p, value, MIN(value_len, bytes));
+			fields[f].num_bits = bits;
+			fields[f].out_value = p;
+			fields[f].in_value = p;
+			p += bytes;
+			f++;
+		}
+		jtag_add_dr_scan(tap, f - scan_first, fields + scan_first, endstate);
+	}
+
+	if (jtag_execute_queue() != ERROR_OK) {
+		free(fields);
+		free(data);
+		Jim_SetResultString(interp, "drscan_binary: jtag execute failed", -1);
+		return JIM_ERR;
+	}
+
+	Jim_Obj *result = Jim_NewListObj(interp, NULL, 0);
+	f = 0;
+	for (int i = first; i < argc; i++) {
+		int len = Jim_ListLength(interp, args[i]);
+		Jim_Obj *scan = Jim_NewListObj(interp, NULL, 0);
+		for (int j = 0; j < len; j += 2) {
+			int bytes = DIV_ROUND_UP(fields[f].num_bits, 8);
+			Jim_ListAppendElement(interp, scan,
+				Jim_NewStringObj(interp, (const char *)fields[f].in_value, bytes));
+			f++;
+		}
+		Jim_ListAppendElement(interp, result, scan);
+	}
+	Jim_SetResult(interp, result);
+
+	free(fields);
+	free(data);
+
+	return JIM_OK;
+}
 
 static int Jim_Command_pathmove(Jim_Interp *interp, int argc, Jim_Obj *const *args)
 {
@@ -287,6 +409,16 @@ static const struct command_registration jtag_command_handlers_to_move[] = {
 			"Other TAPs must be in BYPASS mode.",
 		.usage = "tap_name [num_bits value]* ['-endstate' state_name]",
 	},
+	{
+		.name = "drscan_binary",
+		.mode = COMMAND_EXEC,
+		.jim_handler = Jim_Command_drscan_binary,
+		.help = "Execute one or more Data Register (DR) scans for one "
+			"TAP with a single queue flush, using raw byte strings "
+			"for field values and results.",
+		.usage = "tap_name ['-endstate' state_name] "
+			"{num_bits bytes [num_bits bytes]*}+",
+	},
 	{
 		.name = "flush_count",
 		.mode = COMMAND_EXEC,
@@ -838,6 +970,119 @@ static int jim_jtag_names(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	return JIM_OK;
 }
 
+/* Upper bound on the capture data queued per flush by "jtag sample_loop" */
+#define SAMPLE_LOOP_MAX_BATCH_BYTES	(64 * 1024)
+
+COMMAND_HANDLER(handle_jtag_sample_loop_command)
+{
+	struct jtag_tap *tap;
+	uint64_t instr;
+	unsigned int bits, count, batch;
+	struct fileio *fileio;
+	int retval;
+
+	if (CMD_ARGC < 5 || CMD_ARGC > 6)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	tap = jtag_tap_by_string(CMD_ARGV[0]);
+	if (tap == NULL) {
+		command_print(CMD, "Tap: %s unknown", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	if (tap->ir_length > 64) {
+		command_print(CMD, "Tap: %s has an instruction register longer than 64 bits",
+				CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	retval = parse_u64(CMD_ARGV[1], &instr);
+	if (retval != ERROR_OK)
+		return retval;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], bits);
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[3], count);
+	if (bits == 0 || count == 0) {
+		command_print(CMD, "bit length and sample count must be at least 1");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	unsigned int sample_bytes = DIV_ROUND_UP(bits, 8);
+	batch = MAX(1u, SAMPLE_LOOP_MAX_BATCH_BYTES / sample_bytes);
+	if (CMD_ARGC > 5)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[5], batch);
+	if (batch == 0) {
+		command_print(CMD, "batch size must be at least 1");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	batch = MIN(batch, count);
+
+	uint8_t *samples = malloc((size_t)batch * sample_bytes);
+	if (samples == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	retval = fileio_open(&fileio, CMD_ARGV[4], FILEIO_WRITE, FILEIO_BINARY);
+	if (retval != ERROR_OK) {
+		free(samples);
+		return retval;
+	}
+
+	struct duration bench;
+	duration_start(&bench);
+
+	/* The instruction is loaded once; every DR scan below passes through
+	 * Capture-DR and so takes a new sample. */
+	uint8_t ir_buf[8];
+	struct scan_field ir_field = {
+		.num_bits = tap->ir_length,
+		.out_value = ir_buf,
+		.in_value = NULL,
+	};
+	buf_set_u64(ir_buf, 0, tap->ir_length, instr);
+	jtag_add_ir_scan(tap, &ir_field, TAP_IDLE);
+
+	for (unsigned int done = 0; done < count; ) {
+		unsigned int n = MIN(batch, count - done);
+
+		for (unsigned int i = 0; i < n; i++) {
+			struct scan_field field = {
+				.num_bits = bits,
+				.out_value = NULL,
+				.in_value = samples + i * sample_bytes,
+			};
+			jtag_add_dr_scan(tap, 1, &field, TAP_IDLE);
+		}
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto out;
+
+		size_t written;
+		retval = fileio_write(fileio, (size_t)n * sample_bytes, samples, &written);
+		if (retval != ERROR_OK)
+			goto out;
+		if (written != (size_t)n * sample_bytes) {
+			LOG_ERROR("Short write to %s", CMD_ARGV[4]);
+			retval = ERROR_FAIL;
+			goto out;
+		}
+
+		done += n;
+		keep_alive();
+	}
+
+	if (duration_measure(&bench) == ERROR_OK)
+		command_print(CMD, "captured %u samples of %u bits in %fs (%0.1f samples/s)",
+				count, bits, duration_elapsed(&bench),
+				count / duration_elapsed(&bench));
+
+out:
+	fileio_close(fileio);
+	free(samples);
+	return retval;
+}
+
 COMMAND_HANDLER(handle_jtag_init_command)
 {
 	if (CMD_ARGC != 0)
@@ -936,6 +1181,15 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.jim_handler = jim_jtag_names,
 		.help = "Returns list of all JTAG tap names.",
 	},
+	{
+		.name = "sample_loop",
+		.mode = COMMAND_EXEC,
+		.handler = handle_jtag_sample_loop_command,
+		.help = "Load an instruction once, then capture the data "
+			"register count times, writing the raw captures to a "
+			"binary file.",
+		.usage = "tap_name instruction num_bits count filename [batch]",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
@@ -76,20 +76,58 @@ static int hwthread_fill_thread(struct rtos *rtos, struct target *curr, int thre
 {
 	char tmp_str[HW_THREAD_NAME_STR_SIZE];
 	threadid_t tid = threadid_from_target(curr);
+	struct thread_detail *detail = &rtos->thread_details[thread_num];
 
 	memset(tmp_str, 0, HW_THREAD_NAME_STR_SIZE);
 
 	/* thread-id is the core-id of this core inside the SMP group plus 1 */
-	rtos->thread_details[thread_num].threadid = tid;
+	detail->threadid = tid;
 	/* create the thread name */
-	rtos->thread_details[thread_num].exists = true;
-	rtos->thread_details[thread_num].thread_name_str = strdup(target_name(curr));
+	detail->exists = true;
+	if (!detail->thread_name_str)
+		detail->thread_name_str = strdup(target_name(curr));
+
+	/* The state is the debug reason recorded by the last poll, nothing is
+	 * read from the target here. Registers are only fetched when gdb asks
+	 * for them. */
 	snprintf(tmp_str, HW_THREAD_NAME_STR_SIZE-1, "state: %s", debug_reason_name(curr));
-	rtos->thread_details[thread_num].extra_info_str = strdup(tmp_str);
+	if (!detail->extra_info_str || strcmp(detail->extra_info_str, tmp_str)) {
+		free(detail->extra_info_str);
+		detail->extra_info_str = strdup(tmp_str);
+	}
 
 	return ERROR_OK;
 }
 
+/* Check whether the thread list still describes the examined targets of
+ * the SMP group, in the same order, so that it can be updated in place. */
+static bool hwthread_threadlist_matches(struct rtos *rtos)
+{
+	struct target *target = rtos->target;
+	int thread_num = 0;
+
+	if (!rtos->thread_details)
+		return false;
+
+	if (!target->smp)
+		return rtos->thread_count == 1 &&
+			rtos->thread_details[0].threadid == threadid_from_target(target);
+
+	for (struct target_list *head = target->head; head != NULL; head = head->next) {
+		struct target *curr = head->target;
+
+		if (!target_was_examined(curr))
+			continue;
+
+		if (thread_num >= rtos->thread_count ||
+				rtos->thread_details[thread_num].threadid != threadid_from_target(curr))
+			return false;
+		thread_num++;
+	}
+
+	return thread_num == rtos->thread_count;
+}
+
 static int hwthread_update_threads(struct rtos *rtos)
 {
 	int threads_found = 0;
@@ -117,13 +155,19 @@ static int hwthread_update_threads(struct rtos *rtos)
 	} else
 		thread_list_size = 1;
 
-	/* Wipe out previous thread details if any, but preserve threadid. */
-	int64_t current_threadid = rtos->current_threadid;
-	rtos_free_threadlist(rtos);
-	rtos->current_threadid = current_threadid;
-
-	/* create space for new thread details */
-	rtos->thread_details = malloc(sizeof(struct thread_detail) * thread_list_size);
+	/* Only rebuild the thread list when the SMP group composition
+	 * changed, otherwise refresh the existing entries. */
+	if (!hwthread_threadlist_matches(rtos)) {
+		/* Wipe out previous thread details if any, but preserve threadid. */
+		int64_t current_threadid = rtos->current_threadid;
+		rtos_free_threadlist(rtos);
+		rtos->current_threadid = current_threadid;
+
+		/* create space for new thread details */
+		rtos->thread_details = calloc(thread_list_size, sizeof(struct thread_detail));
+		if (!rtos->thread_details && thread_list_size)
+			return ERROR_FAIL;
+	}
 
 	if (target->smp) {
 		/* loop over all threads */
@@ -314,49 +314,270 @@ static int aarch64_wait_halt_one(struct target *target)
 	return retval;
 }
 
-static int aarch64_prepare_halt_smp(struct target *target, bool exc_target, struct target **p_first)
+/*
+ * The PEs of an SMP group are handled in batches: the CTI and debug register
+ * accesses for all of them are queued and the DAPs run once per step, so the
+ * number of round trips does not depend on the number of cores.
+ */
+struct aarch64_group_regs {
+	uint32_t gate;
+	uint32_t dscr;
+	uint32_t prsr;
+	uint32_t trout;
+};
+
+/* collect the examined PEs of the SMP group, except skip */
+static struct target **aarch64_smp_list(struct target *target, struct target *skip,
+		unsigned int *p_count)
 {
-	int retval = ERROR_OK;
-	struct target_list *head = target->head;
-	struct target *first = NULL;
+	struct target_list *head;
+	struct target **targets;
+	unsigned int count = 0;
 
-	LOG_DEBUG("target %s exc %i", target_name(target), exc_target);
+	foreach_smp_target(head, target->head)
+		count++;
 
-	while (head != NULL) {
+	targets = calloc(count + 1, sizeof(struct target *));
+	if (targets == NULL) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+
+	count = 0;
+	foreach_smp_target(head, target->head) {
 		struct target *curr = head->target;
-		struct armv8_common *armv8 = target_to_armv8(curr);
-		head = head->next;
 
-		if (exc_target && curr == target)
+		if (curr == skip)
 			continue;
 		if (!target_was_examined(curr))
 			continue;
-		if (curr->state != TARGET_RUNNING)
-			continue;
+
+		targets[count++] = curr;
+	}
+
+	*p_count = count;
+	return targets;
+}
+
+static bool aarch64_group_uses_dap(struct target **targets, unsigned int count,
+		struct adiv5_dap *dap)
+{
+	for (unsigned int i = 0; i < count; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
+
+		if (armv8->debug_ap->dap == dap || arm_cti_dap(armv8->cti) == dap)
+			return true;
+	}
+	return false;
+}
+
+/* run the queued transactions on each DAP used by the PEs or their CTIs */
+static int aarch64_run_group(struct target **targets, unsigned int count)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
+		struct adiv5_dap *dap[2] = { armv8->debug_ap->dap, arm_cti_dap(armv8->cti) };
+
+		for (unsigned int j = 0; j < ARRAY_SIZE(dap); j++) {
+			if (j > 0 && dap[j] == dap[0])
+				continue;
+			/* already run for an earlier PE */
+			if (aarch64_group_uses_dap(targets, i, dap[j]))
+				continue;
+
+			int retval2 = dap_run(dap[j]);
+			if (retval == ERROR_OK)
+				retval = retval2;
+		}
+	}
+
+	return retval;
+}
+
+static int aarch64_read_prsr_group(struct target **targets, unsigned int count,
+		struct aarch64_group_regs *regs)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
+
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_PRSR, &regs[i].prsr);
+	}
+
+	/* run what was queued even on error, so it doesn't end up in the next batch */
+	int retval2 = aarch64_run_group(targets, count);
+
+	return retval != ERROR_OK ? retval : retval2;
+}
+
+/* open the CTI gate for channel 0 and set DSCR.HDE on all PEs of the batch */
+static int aarch64_prepare_halt_group(struct target **targets, unsigned int count)
+{
+	struct aarch64_group_regs *regs;
+	int retval = ERROR_OK;
+	int retval2;
+
+	regs = calloc(count + 1, sizeof(struct aarch64_group_regs));
+	if (regs == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
 
 		/* HACK: mark this target as prepared for halting */
-		curr->debug_reason = DBG_REASON_DBGRQ;
+		targets[i]->debug_reason = DBG_REASON_DBGRQ;
+
+		retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &regs[i].gate);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, &regs[i].dscr);
+	}
+	retval2 = aarch64_run_group(targets, count);
+	if (retval == ERROR_OK)
+		retval = retval2;
+	if (retval != ERROR_OK)
+		goto out;
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
 
 		/* open the gate for channel 0 to let HALT requests pass to the CTM */
-		retval = arm_cti_ungate_channel(armv8->cti, 0);
+		retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE,
+				regs[i].gate | CTI_CHNL(0));
+		/* allow Halting Debug Mode */
 		if (retval == ERROR_OK)
-			retval = aarch64_set_dscr_bits(curr, DSCR_HDE, DSCR_HDE);
-		if (retval != ERROR_OK)
-			break;
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, regs[i].dscr | DSCR_HDE);
+	}
+	retval2 = aarch64_run_group(targets, count);
+	if (retval == ERROR_OK)
+		retval = retval2;
+
+out:
+	free(regs);
+	return retval;
+}
+
+/*
+ * Acknowledge the CTI halt event, route restart requests to the PEs and
+ * isolate them from halt events, for all PEs of the batch.
+ */
+static int aarch64_prepare_restart_group(struct target **targets, unsigned int count)
+{
+	struct aarch64_group_regs *regs;
+	int retval = ERROR_OK;
+	int retval2;
+
+	regs = calloc(count + 1, sizeof(struct aarch64_group_regs));
+	if (regs == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
+
+		LOG_DEBUG("%s", target_name(targets[i]));
+
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_DSCR, &regs[i].dscr);
+		if (retval == ERROR_OK)
+			retval = arm_cti_queue_read_reg(armv8->cti, CTI_GATE, &regs[i].gate);
+		/* acknowledge a pending CTI halt event */
+		if (retval == ERROR_OK)
+			retval = arm_cti_queue_write_reg(armv8->cti, CTI_INACK, CTI_TRIG(HALT));
+	}
+	retval2 = aarch64_run_group(targets, count);
+	if (retval == ERROR_OK)
+		retval = retval2;
+	if (retval != ERROR_OK)
+		goto out;
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
+
+		if ((regs[i].dscr & DSCR_ITE) == 0)
+			LOG_ERROR("DSCR.ITE must be set before leaving debug!");
+		if ((regs[i].dscr & DSCR_ERR) != 0)
+			LOG_ERROR("DSCR.ERR must be cleared before leaving debug!");
+
+		/*
+		 * open the CTI gate for channel 1 so that the restart events
+		 * get passed along to all PEs. Also close gate for channel 0
+		 * to isolate the PE from halt events.
+		 */
+		retval = arm_cti_queue_write_reg(armv8->cti, CTI_GATE,
+				(regs[i].gate | CTI_CHNL(1)) & ~CTI_CHNL(0));
+
+		/* make sure that DSCR.HDE is set */
+		if (retval == ERROR_OK)
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, regs[i].dscr | DSCR_HDE);
 
-		LOG_DEBUG("target %s prepared", target_name(curr));
+		/* clear sticky bits in PRSR, SDR is now 0 */
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_PRSR, &regs[i].prsr);
+
+		if (retval == ERROR_OK)
+			retval = arm_cti_queue_read_reg(armv8->cti, CTI_TROUT_STATUS, &regs[i].trout);
+	}
+	retval2 = aarch64_run_group(targets, count);
+	if (retval == ERROR_OK)
+		retval = retval2;
+
+	/* wait for the halt event acknowledge where it didn't complete yet */
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		struct armv8_common *armv8 = target_to_armv8(targets[i]);
+
+		if (regs[i].trout & CTI_TRIG(HALT))
+			retval = arm_cti_ack_events(armv8->cti, CTI_TRIG(HALT));
+	}
+
+out:
+	free(regs);
+	return retval;
+}
 
-		if (first == NULL)
-			first = curr;
+static int aarch64_prepare_halt_smp(struct target *target, bool exc_target, struct target **p_first)
+{
+	struct target **targets;
+	unsigned int count = 0;
+	int retval;
+
+	LOG_DEBUG("target %s exc %i", target_name(target), exc_target);
+
+	targets = aarch64_smp_list(target, exc_target ? target : NULL, &count);
+	if (targets == NULL)
+		return ERROR_FAIL;
+
+	/* only the PEs still running */
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < count; i++) {
+		if (targets[i]->state == TARGET_RUNNING)
+			targets[n++] = targets[i];
+	}
+
+	retval = aarch64_prepare_halt_group(targets, n);
+	if (retval == ERROR_OK) {
+		for (unsigned int i = 0; i < n; i++)
+			LOG_DEBUG("target %s prepared", target_name(targets[i]));
 	}
 
 	if (p_first) {
-		if (exc_target && first)
-			*p_first = first;
+		if (exc_target && n > 0)
+			*p_first = targets[0];
 		else
 			*p_first = target;
 	}
 
+	free(targets);
 	return retval;
 }
 
@@ -408,28 +629,38 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 		return retval;
 
 	/* wait for all PEs to halt */
-	int64_t then = timeval_ms();
-	for (;;) {
-		bool all_halted = true;
-		struct target_list *head;
-		struct target *curr;
+	struct target **targets;
+	struct aarch64_group_regs *regs;
+	unsigned int count = 0;
 
-		foreach_smp_target(head, target->head) {
-			int halted;
+	targets = aarch64_smp_list(target, NULL, &count);
+	if (targets == NULL)
+		return ERROR_FAIL;
+	regs = calloc(count + 1, sizeof(struct aarch64_group_regs));
+	if (regs == NULL) {
+		LOG_ERROR("Out of memory");
+		free(targets);
+		return ERROR_FAIL;
+	}
 
-			curr = head->target;
+	int64_t then = timeval_ms();
+	for (;;) {
+		struct target *curr = NULL;
 
-			if (!target_was_examined(curr))
-				continue;
+		/* read the PRSR of all PEs in one batch */
+		retval = aarch64_read_prsr_group(targets, count, regs);
+		if (retval != ERROR_OK)
+			break;
 
-			retval = aarch64_check_state_one(curr, PRSR_HALT, PRSR_HALT, &halted, NULL);
-			if (retval != ERROR_OK || !halted) {
-				all_halted = false;
+		for (unsigned int i = 0; i < count; i++) {
+			if (!(regs[i].prsr & PRSR_HALT)) {
+				curr = targets[i];
 				break;
 			}
 		}
 
-		if (all_halted)
+		/* all halted */
+		if (curr == NULL)
 			break;
 
 		if (timeval_ms() > then + 1000) {
@@ -449,6 +680,8 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 			break;
 	}
 
+	free(regs);
+	free(targets);
 	return retval;
 }
 
@@ -619,49 +852,7 @@ static int aarch64_restore_one(struct target *target, int current,
  */
 static int aarch64_prepare_restart_one(struct target *target)
 {
-	struct armv8_common *armv8 = target_to_armv8(target);
-	int retval;
-	uint32_t dscr;
-	uint32_t tmp;
-
-	LOG_DEBUG("%s", target_name(target));
-
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-			armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	if ((dscr & DSCR_ITE) == 0)
-		LOG_ERROR("DSCR.ITE must be set before leaving debug!");
-	if ((dscr & DSCR_ERR) != 0)
-		LOG_ERROR("DSCR.ERR must be cleared before leaving debug!");
-
-	/* acknowledge a pending CTI halt event */
-	retval = arm_cti_ack_events(armv8->cti, CTI_TRIG(HALT));
-	/*
-	 * open the CTI gate for channel 1 so that the restart events
-	 * get passed along to all PEs. Also close gate for channel 0
-	 * to isolate the PE from halt events.
-	 */
-	if (retval == ERROR_OK)
-		retval = arm_cti_ungate_channel(armv8->cti, 1);
-	if (retval == ERROR_OK)
-		retval = arm_cti_gate_channel(armv8->cti, 0);
-
-	/* make sure that DSCR.HDE is set */
-	if (retval == ERROR_OK) {
-		dscr |= DSCR_HDE;
-		retval = mem_ap_write_atomic_u32(armv8->debug_ap,
-				armv8->debug_base + CPUV8_DBG_DSCR, dscr);
-	}
-
-	if (retval == ERROR_OK) {
-		/* clear sticky bits in PRSR, SDR is now 0 */
-		retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-				armv8->debug_base + CPUV8_DBG_PRSR, &tmp);
-	}
-
-	return retval;
+	return aarch64_prepare_restart_group(&target, 1);
 }
 
 static int aarch64_do_restart_one(struct target *target, enum restart_mode mode)
@@ -725,37 +916,42 @@ static int aarch64_restart_one(struct target *target, enum restart_mode mode)
 static int aarch64_prep_restart_smp(struct target *target, int handle_breakpoints, struct target **p_first)
 {
 	int retval = ERROR_OK;
-	struct target_list *head;
-	struct target *first = NULL;
+	struct target **targets;
+	unsigned int count = 0;
+	unsigned int n = 0;
 	uint64_t address;
 
-	foreach_smp_target(head, target->head) {
-		struct target *curr = head->target;
+	targets = aarch64_smp_list(target, target, &count);
+	if (targets == NULL)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++) {
+		struct target *curr = targets[i];
 
-		/* skip calling target */
-		if (curr == target)
-			continue;
-		if (!target_was_examined(curr))
-			continue;
 		if (curr->state != TARGET_HALTED)
 			continue;
 
 		/*  resume at current address, not in step mode */
 		retval = aarch64_restore_one(curr, 1, &address, handle_breakpoints, 0);
-		if (retval == ERROR_OK)
-			retval = aarch64_prepare_restart_one(curr);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("failed to restore target %s", target_name(curr));
 			break;
 		}
-		/* remember the first valid target in the group */
-		if (first == NULL)
-			first = curr;
+		targets[n++] = curr;
+	}
+
+	/* prepare the CTIs and debug registers of all restored PEs at once */
+	if (retval == ERROR_OK) {
+		retval = aarch64_prepare_restart_group(targets, n);
+		if (retval != ERROR_OK)
+			LOG_ERROR("failed to prepare SMP group of %s for restart", target_name(target));
 	}
 
+	/* remember the first valid target in the group */
 	if (p_first)
-		*p_first = first;
+		*p_first = n > 0 ? targets[0] : NULL;
 
+	free(targets);
 	return retval;
 }
 
@@ -763,7 +959,6 @@ static int aarch64_prep_restart_smp(struct target *target, int handle_breakpoint
 static int aarch64_step_restart_smp(struct target *target)
 {
 	int retval = ERROR_OK;
-	struct target_list *head;
 	struct target *first = NULL;
 
 	LOG_DEBUG("%s", target_name(target));
@@ -779,38 +974,46 @@ static int aarch64_step_restart_smp(struct target *target)
 		return retval;
 	}
 
-	int64_t then = timeval_ms();
-	for (;;) {
-		struct target *curr = target;
-		bool all_resumed = true;
+	struct target **targets;
+	struct aarch64_group_regs *regs;
+	unsigned int count = 0;
 
-		foreach_smp_target(head, target->head) {
-			uint32_t prsr;
-			int resumed;
+	targets = aarch64_smp_list(target, target, &count);
+	if (targets == NULL)
+		return ERROR_FAIL;
+	regs = calloc(count + 1, sizeof(struct aarch64_group_regs));
+	if (regs == NULL) {
+		LOG_ERROR("Out of memory");
+		free(targets);
+		return ERROR_FAIL;
+	}
 
-			curr = head->target;
+	int64_t then = timeval_ms();
+	for (;;) {
+		struct target *curr = NULL;
 
-			if (curr == target)
-				continue;
+		/* read the PRSR of all PEs in one batch */
+		retval = aarch64_read_prsr_group(targets, count, regs);
+		if (retval != ERROR_OK)
+			break;
 
-			if (!target_was_examined(curr))
-				continue;
+		for (unsigned int i = 0; i < count; i++) {
+			uint32_t prsr = regs[i].prsr;
 
-			retval = aarch64_check_state_one(curr,
-					PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-			if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
-				all_resumed = false;
+			if (!(prsr & PRSR_SDR) && (prsr & PRSR_HALT)) {
+				curr = targets[i];
 				break;
 			}
 
-			if (curr->state != TARGET_RUNNING) {
-				curr->state = TARGET_RUNNING;
-				curr->debug_reason = DBG_REASON_NOTHALTED;
-				target_call_event_callbacks(curr, TARGET_EVENT_RESUMED);
+			if (targets[i]->state != TARGET_RUNNING) {
+				targets[i]->state = TARGET_RUNNING;
+				targets[i]->debug_reason = DBG_REASON_NOTHALTED;
+				target_call_event_callbacks(targets[i], TARGET_EVENT_RESUMED);
 			}
 		}
 
-		if (all_resumed)
+		/* all resumed */
+		if (curr == NULL)
 			break;
 
 		if (timeval_ms() > then + 1000) {
@@ -828,8 +1031,10 @@ static int aarch64_step_restart_smp(struct target *target)
 		retval = aarch64_do_restart_one(curr, RESTART_LAZY);
 		if (retval != ERROR_OK)
 			break;
-}
+	}
 
+	free(regs);
+	free(targets);
 	return retval;
 }
 
@@ -654,6 +654,13 @@ int dap_dp_init(struct adiv5_dap *dap)
 
 	dap_invalidate_cache(dap);
 
+	/* the DAP may have been replaced or repowered, probe the APs again */
+	for (int i = 0; i <= 255; i++) {
+		dap->ap[i].idr_valid = false;
+		dap->ap[i].base_valid = false;
+		dap_free_rom_map(&dap->ap[i]);
+	}
+
 	/*
 	 * Early initialize dap->dp_ctrl_stat.
 	 * In jtag mode only, if the following atomic reads fail and set the
@@ -853,14 +860,25 @@ int dap_find_ap(struct adiv5_dap *dap, enum ap_type type_to_find, struct adiv5_a
 	/* Maximum AP number is 255 since the SELECT register is 8 bits */
 	for (ap_num = 0; ap_num <= DP_APSEL_MAX; ap_num++) {
 
+		struct adiv5_ap *ap = dap_ap(dap, ap_num);
+		int retval = ERROR_OK;
+
 		/* read the IDR register of the Access Port */
 		uint32_t id_val = 0;
 
-		int retval = dap_queue_ap_read(dap_ap(dap, ap_num), AP_REG_IDR, &id_val);
-		if (retval != ERROR_OK)
-			return retval;
+		if (ap->idr_valid) {
+			id_val = ap->idr_value;
+		} else {
+			retval = dap_queue_ap_read(ap, AP_REG_IDR, &id_val);
+			if (retval != ERROR_OK)
+				return retval;
 
-		retval = dap_run(dap);
+			retval = dap_run(dap);
+			if (retval == ERROR_OK && id_val != 0) {
+				ap->idr_value = id_val;
+				ap->idr_valid = true;
+			}
+		}
 
 		/* IDR bits:
 		 * 31-28 : Revision
@@ -907,6 +925,12 @@ int dap_get_debugbase(struct adiv5_ap *ap,
 	struct adiv5_dap *dap = ap->dap;
 	int retval;
 
+	if (ap->base_valid) {
+		*dbgbase = ap->base_value;
+		*apid = ap->idr_value;
+		return ERROR_OK;
+	}
+
 	retval = dap_queue_ap_read(ap, MEM_AP_REG_BASE, dbgbase);
 	if (retval != ERROR_OK)
 		return retval;
@@ -917,63 +941,238 @@ int dap_get_debugbase(struct adiv5_ap *ap,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* an AP that is not implemented reads as zero, don't cache that */
+	if (*apid != 0) {
+		ap->base_value = *dbgbase;
+		ap->idr_value = *apid;
+		ap->idr_valid = true;
+		ap->base_valid = true;
+	}
+
+	return ERROR_OK;
+}
+
+/* ROM table entries end at the start of the reserved area at 0xF00 */
+#define ROM_TABLE_MAX_ENTRIES	(0xF00 / 4)
+/* ROM table entries read per queue run */
+#define ROM_TABLE_READ_BATCH	32
+#define ROM_TABLE_MAX_DEPTH	16
+
+/**
+ * Read the entries of the ROM table at @a base_addr up to and including the
+ * terminating zero entry, a batch of them per queue run.
+ */
+static int dap_read_rom_entries(struct adiv5_ap *ap, uint32_t base_addr,
+		uint32_t *entries, unsigned int *count)
+{
+	uint8_t buf[ROM_TABLE_READ_BATCH * 4];
+
+	*count = 0;
+	while (*count < ROM_TABLE_MAX_ENTRIES) {
+		unsigned int n = MIN(ROM_TABLE_READ_BATCH, ROM_TABLE_MAX_ENTRIES - *count);
+		int retval = mem_ap_read_buf(ap, buf, 4, n, base_addr + *count * 4);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (unsigned int i = 0; i < n; i++) {
+			entries[(*count)++] = le_to_h_u32(&buf[4 * i]);
+			if (entries[*count - 1] == 0)
+				return ERROR_OK;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+static int dap_rom_map_add(struct adiv5_rom_map *map, uint32_t base, uint32_t devtype)
+{
+	if (map->count == map->size) {
+		unsigned int size = map->size ? 2 * map->size : 16;
+		struct adiv5_rom_component *components = realloc(map->components,
+				size * sizeof(*components));
+		if (!components) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		map->components = components;
+		map->size = size;
+	}
+
+	map->components[map->count].base = base;
+	map->components[map->count].devtype = devtype;
+	map->count++;
+
 	return ERROR_OK;
 }
 
+/**
+ * Walk the ROM table at @a dbgbase and append its components to @a map.
+ * The CIDR1 and DEVTYPE registers of all components of one table level
+ * are read in a single queue run. If that fails, e.g. because a core is
+ * powered down, they are read one by one to find the unreadable one.
+ */
+static int dap_rom_walk(struct adiv5_ap *ap, uint32_t dbgbase,
+		struct adiv5_rom_map *map, int depth)
+{
+	uint32_t base_addr = dbgbase & 0xFFFFF000;
+	uint32_t *entries, *cid1, *devtype;
+	unsigned int count = 0;
+	bool batched;
+	int retval;
+
+	if (depth > ROM_TABLE_MAX_DEPTH) {
+		LOG_ERROR("ROM table at 0x%08" PRIx32 " nested too deep", base_addr);
+		return ERROR_FAIL;
+	}
+
+	entries = malloc(ROM_TABLE_MAX_ENTRIES * sizeof(uint32_t));
+	cid1 = malloc(ROM_TABLE_MAX_ENTRIES * sizeof(uint32_t));
+	devtype = malloc(ROM_TABLE_MAX_ENTRIES * sizeof(uint32_t));
+	if (!entries || !cid1 || !devtype) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
+	retval = dap_read_rom_entries(ap, base_addr, entries, &count);
+	if (retval != ERROR_OK)
+		goto done;
+
+	if (depth == 0)
+		map->entry0 = entries[0];
+
+	for (unsigned int i = 0; i < count && retval == ERROR_OK; i++) {
+		if (!(entries[i] & 0x1))
+			continue;
+		uint32_t component_base = base_addr + (entries[i] & 0xFFFFF000);
+		retval = mem_ap_read_u32(ap, component_base | 0xff4, &cid1[i]);
+		if (retval == ERROR_OK)
+			retval = mem_ap_read_u32(ap, component_base | 0xfcc, &devtype[i]);
+	}
+	if (retval == ERROR_OK)
+		retval = dap_run(ap->dap);
+	batched = retval == ERROR_OK;
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (!(entries[i] & 0x1))
+			continue;
+		uint32_t component_base = base_addr + (entries[i] & 0xFFFFF000);
+
+		if (!batched) {
+			retval = mem_ap_read_atomic_u32(ap, component_base | 0xff4, &cid1[i]);
+			if (retval != ERROR_OK) {
+				map->unreadable_base = component_base;
+				goto done;
+			}
+		}
+
+		if (((cid1[i] >> 4) & 0x0f) == 1) {
+			retval = dap_rom_walk(ap, component_base, map, depth + 1);
+			if (retval != ERROR_OK)
+				goto done;
+		}
+
+		if (!batched) {
+			retval = mem_ap_read_atomic_u32(ap, component_base | 0xfcc, &devtype[i]);
+			if (retval != ERROR_OK)
+				goto done;
+		}
+
+		retval = dap_rom_map_add(map, component_base, devtype[i]);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+	retval = ERROR_OK;
+
+done:
+	free(entries);
+	free(cid1);
+	free(devtype);
+	return retval;
+}
+
+void dap_free_rom_map(struct adiv5_ap *ap)
+{
+	if (!ap->rom_map)
+		return;
+
+	free(ap->rom_map->components);
+	free(ap->rom_map);
+	ap->rom_map = NULL;
+}
+
 int dap_lookup_cs_component(struct adiv5_ap *ap,
 			uint32_t dbgbase, uint8_t type, uint32_t *addr, int32_t *idx)
 {
-	uint32_t romentry, entry_offset = 0, component_base, devtype;
+	uint32_t base_addr = dbgbase & 0xFFFFF000;
+	struct adiv5_rom_map *map = ap->rom_map;
+	int walk_retval = ERROR_OK;
 	int retval;
 
 	*addr = 0;
 
-	do {
-		retval = mem_ap_read_atomic_u32(ap, (dbgbase&0xFFFFF000) |
-						entry_offset, &romentry);
+	/* The map of the last complete walk is kept across resets, check
+	 * that it still describes this ROM table before using it */
+	if (map && map->base == base_addr) {
+		uint32_t entry0;
+		retval = mem_ap_read_atomic_u32(ap, base_addr, &entry0);
 		if (retval != ERROR_OK)
 			return retval;
+		if (entry0 != map->entry0) {
+			LOG_DEBUG("ROM table at 0x%08" PRIx32 " changed", base_addr);
+			dap_free_rom_map(ap);
+			map = NULL;
+		}
+	} else {
+		map = NULL;
+	}
 
-		component_base = (dbgbase & 0xFFFFF000)
-			+ (romentry & 0xFFFFF000);
-
-		if (romentry & 0x1) {
-			uint32_t c_cid1;
-			retval = mem_ap_read_atomic_u32(ap, component_base | 0xff4, &c_cid1);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Can't read component with base address 0x%" PRIx32
-					  ", the corresponding core might be turned off", component_base);
-				return retval;
-			}
-			if (((c_cid1 >> 4) & 0x0f) == 1) {
-				retval = dap_lookup_cs_component(ap, component_base,
-							type, addr, idx);
-				if (retval == ERROR_OK)
-					break;
-				if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
-					return retval;
-			}
+	if (!map) {
+		map = calloc(1, sizeof(*map));
+		if (!map) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		map->base = base_addr;
+
+		walk_retval = dap_rom_walk(ap, base_addr, map, 0);
+		if (walk_retval == ERROR_OK) {
+			LOG_DEBUG("ROM table at 0x%08" PRIx32 ": %u components",
+					base_addr, map->count);
+			dap_free_rom_map(ap);
+			ap->rom_map = map;
+		}
+	}
 
-			retval = mem_ap_read_atomic_u32(ap,
-					(component_base & 0xfffff000) | 0xfcc,
-					&devtype);
-			if (retval != ERROR_OK)
-				return retval;
-			if ((devtype & 0xff) == type) {
-				if (!*idx) {
-					*addr = component_base;
-					break;
-				} else
-					(*idx)--;
-			}
+	/* A partial map from a walk that failed is still good for the
+	 * components it reached */
+	for (unsigned int i = 0; i < map->count; i++) {
+		if ((map->components[i].devtype & 0xff) != type)
+			continue;
+		if (!*idx) {
+			*addr = map->components[i].base;
+			break;
 		}
-		entry_offset += 4;
-	} while (romentry > 0);
+		(*idx)--;
+	}
+
+	if (*addr)
+		retval = ERROR_OK;
+	else if (walk_retval != ERROR_OK)
+		retval = walk_retval;
+	else
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 
-	if (!*addr)
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	if (retval != ERROR_OK && map->unreadable_base)
+		LOG_ERROR("Can't read component with base address 0x%" PRIx32
+			  ", the corresponding core might be turned off", map->unreadable_base);
 
-	return ERROR_OK;
+	if (map != ap->rom_map) {
+		free(map->components);
+		free(map);
+	}
+
+	return retval;
 }
 
 static int dap_read_part_id(struct adiv5_ap *ap, uint32_t component_base, uint32_t *cid, uint64_t *pid)
@@ -1243,18 +1442,29 @@ static int dap_rom_display(struct command_invocation *cmd,
 			command_print(cmd, "\t\tMEMTYPE system memory not present: dedicated debug bus");
 
 		/* Read ROM table entries from base address until we get 0x00000000 or reach the reserved area */
-		for (uint16_t entry_offset = 0; entry_offset < 0xF00; entry_offset += 4) {
-			uint32_t romentry;
-			retval = mem_ap_read_atomic_u32(ap, base_addr | entry_offset, &romentry);
-			if (retval != ERROR_OK)
-				return retval;
+		uint32_t *entries = malloc(ROM_TABLE_MAX_ENTRIES * sizeof(uint32_t));
+		unsigned int count;
+		if (!entries) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		retval = dap_read_rom_entries(ap, base_addr, entries, &count);
+		if (retval != ERROR_OK) {
+			free(entries);
+			return retval;
+		}
+		for (unsigned int i = 0; i < count; i++) {
+			uint16_t entry_offset = i * 4;
+			uint32_t romentry = entries[i];
 			command_print(cmd, "\t%sROMTABLE[0x%x] = 0x%" PRIx32 "",
 					tabs, entry_offset, romentry);
 			if (romentry & 0x01) {
 				/* Recurse */
 				retval = dap_rom_display(cmd, ap, base_addr + (romentry & 0xFFFFF000), depth + 1);
-				if (retval != ERROR_OK)
+				if (retval != ERROR_OK) {
+					free(entries);
 					return retval;
+				}
 			} else if (romentry != 0) {
 				command_print(cmd, "\t\tComponent not present");
 			} else {
@@ -1262,6 +1472,7 @@ static int dap_rom_display(struct command_invocation *cmd,
 				break;
 			}
 		}
+		free(entries);
 	} else if (class == 9) { /* CoreSight component */
 		const char *major = "Reserved", *subtype = "Reserved";
 
@@ -167,6 +167,26 @@ enum swd_special_seq {
 	DORMANT_TO_SWD,
 };
 
+/**
+ * CoreSight components found by walking a ROM table, in the order
+ * dap_lookup_cs_component() visits them: the components of a nested ROM
+ * table come before the nested table itself.
+ */
+struct adiv5_rom_map {
+	/* base address of the top level ROM table */
+	uint32_t base;
+	/* its first entry, re-read to validate the cached map */
+	uint32_t entry0;
+	/* base address of the component that stopped the walk, if any */
+	uint32_t unreadable_base;
+	unsigned int count;
+	unsigned int size;
+	struct adiv5_rom_component {
+		uint32_t base;
+		uint32_t devtype;
+	} *components;
+};
+
 /**
  * This represents an ARM Debug Interface (v5) Access Port (AP).
  * Most common is a MEM-AP, for memory access.
@@ -218,6 +238,23 @@ struct adiv5_ap {
 
 	/* true if tar_value is in sync with TAR register */
 	bool tar_valid;
+
+	/**
+	 * Cache for the read-only AP_REG_IDR and (MEM-AP) AP_REG_BASE
+	 * registers, filled on first use, so that several targets behind
+	 * the same DAP probe the APs only once.
+	 * Cleared by dap_dp_init().
+	 */
+	uint32_t idr_value;
+	bool idr_valid;
+	uint32_t base_value;
+	bool base_valid;
+
+	/**
+	 * Result of the last complete ROM table walk on this AP, kept across
+	 * target resets and freed by dap_dp_init(). NULL if there is none.
+	 */
+	struct adiv5_rom_map *rom_map;
 };
 
 
@@ -573,6 +610,9 @@ static inline struct adiv5_ap *dap_ap(struct adiv5_dap *dap, uint8_t ap_num)
 int dap_lookup_cs_component(struct adiv5_ap *ap,
 			uint32_t dbgbase, uint8_t type, uint32_t *addr, int32_t *idx);
 
+/* Drop the cached ROM table walk of an AP */
+void dap_free_rom_map(struct adiv5_ap *ap);
+
 struct target;
 
 /* Put debug link into SWD mode */
@@ -144,6 +144,9 @@ int dap_cleanup_all(void)
 		if (dap->ops && dap->ops->quit)
 			dap->ops->quit(dap);
 
+		for (int i = 0; i <= DP_APSEL_MAX; i++)
+			dap_free_rom_map(&dap->ap[i]);
+
 		free(obj->name);
 		free(obj);
 	}
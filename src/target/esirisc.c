@@ -1591,6 +1591,11 @@ static int esirisc_init_target(struct command_context *cmd_ctx, struct target *t
 	return ERROR_OK;
 }
 
+static void esirisc_deinit_target(struct target *target)
+{
+	esirisc_trace_deinit(target);
+}
+
 static int esirisc_examine(struct target *target)
 {
 	struct esirisc_common *esirisc = target_to_esirisc(target);
@@ -1829,5 +1834,6 @@ struct target_type esirisc_target = {
 
 	.target_create = esirisc_target_create,
 	.init_target = esirisc_init_target,
+	.deinit_target = esirisc_deinit_target,
 	.examine = esirisc_examine,
 };
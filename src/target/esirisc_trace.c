@@ -20,6 +20,9 @@
 #include "config.h"
 #endif
 
+#include <stdarg.h>
+#include <stdio.h>
+
 #include <helper/binarybuffer.h>
 #include <helper/command.h>
 #include <helper/fileio.h>
@@ -85,6 +88,8 @@ static const char * const esirisc_trace_trigger_strings[] = {
 	"high", "low",	/* start only */
 };
 
+static void esirisc_trace_stream_reset(struct esirisc_trace *trace_info);
+
 static int esirisc_trace_clear_status(struct target *target)
 {
 	struct esirisc_common *esirisc = target_to_esirisc(target);
@@ -294,31 +299,79 @@ static int esirisc_trace_init(struct target *target)
 		return retval;
 	}
 
+	/* streaming restarts from the beginning of the buffer */
+	if (trace_info->stream)
+		esirisc_trace_stream_reset(trace_info);
+
 	return ERROR_OK;
 }
 
-static int esirisc_trace_buf_get_u32(uint8_t *buffer, uint32_t size,
-		unsigned *pos, unsigned count, uint32_t *value)
+/* bit reader over captured trace data; when streaming it is refilled as the
+ * target writes more of the buffer */
+struct esirisc_trace_reader {
+	uint8_t *buffer;
+	uint32_t size;
+	unsigned pos;
+};
+
+/* decoded trace goes either to a command or appended to a file */
+struct esirisc_trace_sink {
+	struct command_invocation *cmd;
+	FILE *file;
+};
+
+struct esirisc_trace_stream {
+	struct esirisc_trace_sink sink;
+	target_addr_t address;		/* next trace buffer address to read */
+	struct esirisc_trace_reader reader;
+	bool overrun;				/* unread data was lost, wait for a restart */
+};
+
+static void esirisc_trace_print(struct esirisc_trace_sink *sink, const char *format, ...)
+__attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
+
+static void esirisc_trace_print(struct esirisc_trace_sink *sink, const char *format, ...)
 {
-	const unsigned num_bits = size * 8;
+	va_list ap;
+	char *string;
+
+	va_start(ap, format);
+	string = alloc_vprintf(format, ap);
+	va_end(ap);
+
+	if (string == NULL)
+		return;
 
-	if (*pos+count > num_bits)
+	if (sink->file)
+		fprintf(sink->file, "%s\n", string);
+	else
+		command_print(sink->cmd, "%s", string);
+
+	free(string);
+}
+
+static int esirisc_trace_buf_get_u32(struct esirisc_trace_reader *reader,
+		unsigned count, uint32_t *value)
+{
+	const unsigned num_bits = reader->size * 8;
+
+	if (reader->pos+count > num_bits)
 		return ERROR_FAIL;
 
-	*value = buf_get_u32(buffer, *pos, count);
-	*pos += count;
+	*value = buf_get_u32(reader->buffer, reader->pos, count);
+	reader->pos += count;
 
 	return ERROR_OK;
 }
 
-static int esirisc_trace_buf_get_pc(struct target *target, uint8_t *buffer, uint32_t size,
-		unsigned *pos, uint32_t *value)
+static int esirisc_trace_buf_get_pc(struct target *target, struct esirisc_trace_reader *reader,
+		uint32_t *value)
 {
 	struct esirisc_common *esirisc = target_to_esirisc(target);
 	struct esirisc_trace *trace_info = &esirisc->trace_info;
 	int retval;
 
-	retval = esirisc_trace_buf_get_u32(buffer, size, pos, trace_info->pc_bits, value);
+	retval = esirisc_trace_buf_get_u32(reader, trace_info->pc_bits, value);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -330,12 +383,23 @@ static int esirisc_trace_buf_get_pc(struct target *target, uint8_t *buffer, uint
 static int esirisc_trace_read_memory(struct target *target, target_addr_t address, uint32_t size,
 		uint8_t *buffer)
 {
-	int retval;
+	int retval = ERROR_OK;
 
 	if (target->state != TARGET_HALTED)
 		return ERROR_TARGET_NOT_HALTED;
 
-	retval = target_read_memory(target, address, 1, size, buffer);
+	/* bytes up to the first word boundary, then whole words, then the rest */
+	uint32_t head = MIN(size, (4 - (address & 3)) & 3);
+	uint32_t words = (size - head) / 4;
+	uint32_t tail = size - head - 4 * words;
+
+	if (head)
+		retval = target_read_memory(target, address, 1, head, buffer);
+	if (retval == ERROR_OK && words)
+		retval = target_read_memory(target, address + head, 4, words, buffer + head);
+	if (retval == ERROR_OK && tail)
+		retval = target_read_memory(target, address + head + 4 * words, 1, tail,
+				buffer + head + 4 * words);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("%s: failed to read trace data", target_name(target));
 		return retval;
@@ -385,134 +449,148 @@ static int esirisc_trace_read_buffer(struct target *target, uint8_t *buffer)
 			buffer_cur - trace_info->buffer_start, buffer);
 }
 
-static int esirisc_trace_analyze_full(struct command_invocation *cmd, uint8_t *buffer, uint32_t size)
+/*
+ * Decode a single packet. If the packet is incomplete the reader is left at
+ * its start and ERROR_BUF_TOO_SMALL is returned, so decoding can resume once
+ * more data has been read.
+ */
+static int esirisc_trace_decode_full(struct target *target, struct esirisc_trace_sink *sink,
+		struct esirisc_trace_reader *reader, bool *end)
 {
-	struct target *target = get_current_target(cmd->ctx);
-	const uint32_t num_bits = size * 8;
+	const unsigned start = reader->pos;
+	uint32_t id;
 	int retval;
 
-	unsigned pos = 0;
-	while (pos < num_bits) {
-		uint32_t id;
+	*end = false;
 
-		retval = esirisc_trace_buf_get_u32(buffer, size, &pos, 2, &id);
-		if (retval != ERROR_OK)
-			goto fail;
-
-		switch (id) {
-			case ESIRISC_TRACE_ID_EXECUTE:
-			case ESIRISC_TRACE_ID_STALL:
-			case ESIRISC_TRACE_ID_BRANCH:
-				command_print(cmd, "%s", esirisc_trace_id_strings[id]);
-				break;
-
-			case ESIRISC_TRACE_ID_EXTENDED: {
-				uint32_t ext_id;
-
-				retval = esirisc_trace_buf_get_u32(buffer, size, &pos, 4, &ext_id);
-				if (retval != ERROR_OK)
-					goto fail;
-
-				switch (ext_id) {
-					case ESIRISC_TRACE_EXT_ID_STOP:
-					case ESIRISC_TRACE_EXT_ID_WAIT:
-					case ESIRISC_TRACE_EXT_ID_MULTICYCLE:
-						command_print(cmd, "%s", esirisc_trace_ext_id_strings[ext_id]);
-						break;
-
-					case ESIRISC_TRACE_EXT_ID_ERET:
-					case ESIRISC_TRACE_EXT_ID_PC:
-					case ESIRISC_TRACE_EXT_ID_INDIRECT:
-					case ESIRISC_TRACE_EXT_ID_END_PC: {
-						uint32_t pc;
-
-						retval = esirisc_trace_buf_get_pc(target, buffer, size, &pos, &pc);
-						if (retval != ERROR_OK)
-							goto fail;
-
-						command_print(cmd, "%s PC: 0x%" PRIx32,
-								esirisc_trace_ext_id_strings[ext_id], pc);
-
-						if (ext_id == ESIRISC_TRACE_EXT_ID_END_PC) {
-							command_print(cmd, "--- end of trace ---");
-							return ERROR_OK;
-						}
-						break;
-					}
-					case ESIRISC_TRACE_EXT_ID_EXCEPTION: {
-						uint32_t eid, epc;
-
-						retval = esirisc_trace_buf_get_u32(buffer, size, &pos, 6, &eid);
-						if (retval != ERROR_OK)
-							goto fail;
-
-						retval = esirisc_trace_buf_get_pc(target, buffer, size, &pos, &epc);
-						if (retval != ERROR_OK)
-							goto fail;
-
-						command_print(cmd, "%s EID: 0x%" PRIx32 ", EPC: 0x%" PRIx32,
-								esirisc_trace_ext_id_strings[ext_id], eid, epc);
-						break;
-					}
-					case ESIRISC_TRACE_EXT_ID_COUNT: {
-						uint32_t count;
-
-						retval = esirisc_trace_buf_get_u32(buffer, size, &pos, 6, &count);
-						if (retval != ERROR_OK)
-							goto fail;
-
-						command_print(cmd, "repeats %" PRId32 " %s", count,
-								(count == 1) ? "time" : "times");
-						break;
-					}
-					case ESIRISC_TRACE_EXT_ID_END:
-						command_print(cmd, "--- end of trace ---");
-						return ERROR_OK;
-
-					default:
-						command_print(cmd, "invalid extended trace ID: %" PRId32, ext_id);
-						return ERROR_FAIL;
+	retval = esirisc_trace_buf_get_u32(reader, 2, &id);
+	if (retval != ERROR_OK)
+		goto incomplete;
+
+	switch (id) {
+		case ESIRISC_TRACE_ID_EXECUTE:
+		case ESIRISC_TRACE_ID_STALL:
+		case ESIRISC_TRACE_ID_BRANCH:
+			esirisc_trace_print(sink, "%s", esirisc_trace_id_strings[id]);
+			break;
+
+		case ESIRISC_TRACE_ID_EXTENDED: {
+			uint32_t ext_id;
+
+			retval = esirisc_trace_buf_get_u32(reader, 4, &ext_id);
+			if (retval != ERROR_OK)
+				goto incomplete;
+
+			switch (ext_id) {
+				case ESIRISC_TRACE_EXT_ID_STOP:
+				case ESIRISC_TRACE_EXT_ID_WAIT:
+				case ESIRISC_TRACE_EXT_ID_MULTICYCLE:
+					esirisc_trace_print(sink, "%s", esirisc_trace_ext_id_strings[ext_id]);
+					break;
+
+				case ESIRISC_TRACE_EXT_ID_ERET:
+				case ESIRISC_TRACE_EXT_ID_PC:
+				case ESIRISC_TRACE_EXT_ID_INDIRECT:
+				case ESIRISC_TRACE_EXT_ID_END_PC: {
+					uint32_t pc;
+
+					retval = esirisc_trace_buf_get_pc(target, reader, &pc);
+					if (retval != ERROR_OK)
+						goto incomplete;
+
+					esirisc_trace_print(sink, "%s PC: 0x%" PRIx32,
+							esirisc_trace_ext_id_strings[ext_id], pc);
+
+					if (ext_id == ESIRISC_TRACE_EXT_ID_END_PC)
+						*end = true;
+					break;
+				}
+				case ESIRISC_TRACE_EXT_ID_EXCEPTION: {
+					uint32_t eid, epc;
+
+					retval = esirisc_trace_buf_get_u32(reader, 6, &eid);
+					if (retval != ERROR_OK)
+						goto incomplete;
+
+					retval = esirisc_trace_buf_get_pc(target, reader, &epc);
+					if (retval != ERROR_OK)
+						goto incomplete;
+
+					esirisc_trace_print(sink, "%s EID: 0x%" PRIx32 ", EPC: 0x%" PRIx32,
+							esirisc_trace_ext_id_strings[ext_id], eid, epc);
+					break;
+				}
+				case ESIRISC_TRACE_EXT_ID_COUNT: {
+					uint32_t count;
+
+					retval = esirisc_trace_buf_get_u32(reader, 6, &count);
+					if (retval != ERROR_OK)
+						goto incomplete;
+
+					esirisc_trace_print(sink, "repeats %" PRId32 " %s", count,
+							(count == 1) ? "time" : "times");
+					break;
 				}
-				break;
+				case ESIRISC_TRACE_EXT_ID_END:
+					*end = true;
+					break;
+
+				default:
+					esirisc_trace_print(sink, "invalid extended trace ID: %" PRId32, ext_id);
+					return ERROR_FAIL;
 			}
-			default:
-				command_print(cmd, "invalid trace ID: %" PRId32, id);
-				return ERROR_FAIL;
+			break;
 		}
+		default:
+			esirisc_trace_print(sink, "invalid trace ID: %" PRId32, id);
+			return ERROR_FAIL;
 	}
 
-fail:
-	command_print(cmd, "trace buffer too small");
+	return ERROR_OK;
+
+incomplete:
+	reader->pos = start;
 	return ERROR_BUF_TOO_SMALL;
 }
 
-static int esirisc_trace_analyze_simple(struct command_invocation *cmd, uint8_t *buffer, uint32_t size)
+static int esirisc_trace_decode_simple(struct target *target, struct esirisc_trace_sink *sink,
+		struct esirisc_trace_reader *reader, bool *end)
 {
-	struct target *target = get_current_target(cmd->ctx);
 	struct esirisc_common *esirisc = target_to_esirisc(target);
 	struct esirisc_trace *trace_info = &esirisc->trace_info;
 	const uint32_t end_of_trace = BIT_MASK(trace_info->pc_bits) << 1;
-	const uint32_t num_bits = size * 8;
+	uint32_t pc;
 	int retval;
 
-	unsigned pos = 0;
-	while (pos < num_bits) {
-		uint32_t pc;
+	retval = esirisc_trace_buf_get_pc(target, reader, &pc);
+	if (retval != ERROR_OK)
+		return ERROR_BUF_TOO_SMALL;
 
-		retval = esirisc_trace_buf_get_pc(target, buffer, size, &pos, &pc);
-		if (retval != ERROR_OK)
-			break;
+	*end = (pc == end_of_trace);
+	if (!*end)
+		esirisc_trace_print(sink, "PC: 0x%" PRIx32, pc);
 
-		if (pc == end_of_trace) {
-			command_print(cmd, "--- end of trace ---");
-			return ERROR_OK;
-		}
+	return ERROR_OK;
+}
 
-		command_print(cmd, "PC: 0x%" PRIx32, pc);
-	}
+static int esirisc_trace_decode(struct target *target, struct esirisc_trace_sink *sink,
+		struct esirisc_trace_reader *reader, bool *end)
+{
+	struct esirisc_common *esirisc = target_to_esirisc(target);
+	struct esirisc_trace *trace_info = &esirisc->trace_info;
 
-	command_print(cmd, "trace buffer too small");
-	return ERROR_BUF_TOO_SMALL;
+	switch (trace_info->format) {
+		case ESIRISC_TRACE_FORMAT_FULL:
+		case ESIRISC_TRACE_FORMAT_BRANCH:
+			return esirisc_trace_decode_full(target, sink, reader, end);
+
+		case ESIRISC_TRACE_FORMAT_ICACHE:
+			return esirisc_trace_decode_simple(target, sink, reader, end);
+
+		default:
+			esirisc_trace_print(sink, "invalid trace format: %i", trace_info->format);
+			return ERROR_FAIL;
+	}
 }
 
 static int esirisc_trace_analyze(struct command_invocation *cmd, uint8_t *buffer, uint32_t size)
@@ -520,24 +598,44 @@ static int esirisc_trace_analyze(struct command_invocation *cmd, uint8_t *buffer
 	struct target *target = get_current_target(cmd->ctx);
 	struct esirisc_common *esirisc = target_to_esirisc(target);
 	struct esirisc_trace *trace_info = &esirisc->trace_info;
+	struct esirisc_trace_sink sink = { .cmd = cmd };
+	struct esirisc_trace_reader reader = { .buffer = buffer, .size = size };
+	int retval;
 
 	switch (trace_info->format) {
 		case ESIRISC_TRACE_FORMAT_FULL:
 			command_print(cmd, "--- full pipeline ---");
-			return esirisc_trace_analyze_full(cmd, buffer, size);
+			break;
 
 		case ESIRISC_TRACE_FORMAT_BRANCH:
 			command_print(cmd, "--- branches taken ---");
-			return esirisc_trace_analyze_full(cmd, buffer, size);
+			break;
 
 		case ESIRISC_TRACE_FORMAT_ICACHE:
 			command_print(cmd, "--- icache misses ---");
-			return esirisc_trace_analyze_simple(cmd, buffer, size);
+			break;
 
 		default:
 			command_print(cmd, "invalid trace format: %i", trace_info->format);
 			return ERROR_FAIL;
 	}
+
+	for (;;) {
+		bool end;
+
+		retval = esirisc_trace_decode(target, &sink, &reader, &end);
+		if (retval == ERROR_BUF_TOO_SMALL) {
+			command_print(cmd, "trace buffer too small");
+			return retval;
+		}
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (end) {
+			command_print(cmd, "--- end of trace ---");
+			return ERROR_OK;
+		}
+	}
 }
 
 static int esirisc_trace_analyze_buffer(struct command_invocation *cmd)
@@ -670,6 +768,202 @@ done:
 	return retval;
 }
 
+/* append the trace buffer contents up to end to the stream's reader */
+static int esirisc_trace_stream_read(struct target *target, struct esirisc_trace_stream *stream,
+		target_addr_t end)
+{
+	struct esirisc_trace_reader *reader = &stream->reader;
+	uint32_t size = end - stream->address;
+	int retval;
+
+	if (size == 0)
+		return ERROR_OK;
+
+	retval = esirisc_trace_read_memory(target, stream->address, size,
+			reader->buffer + reader->size);
+	if (retval != ERROR_OK)
+		return retval;
+
+	reader->size += size;
+	stream->address = end;
+
+	return ERROR_OK;
+}
+
+static void esirisc_trace_stream_reset(struct esirisc_trace *trace_info)
+{
+	struct esirisc_trace_stream *stream = trace_info->stream;
+
+	stream->address = trace_info->buffer_start;
+	stream->reader.size = 0;
+	stream->reader.pos = 0;
+	stream->overrun = false;
+}
+
+/*
+ * On every halt, read the part of the trace buffer written since the last
+ * one and decode it. Trace CSRs and memory are only accessed while the core
+ * is halted, as everywhere else in this file.
+ *
+ * Once the buffer has wrapped or overflowed, data that was not read yet may
+ * have been overwritten and the next packet boundary is unknown. Nothing
+ * more is decoded until 'esirisc trace init' restarts the trace.
+ */
+static int esirisc_trace_stream_drain(struct target *target)
+{
+	struct esirisc_common *esirisc = target_to_esirisc(target);
+	struct esirisc_jtag *jtag_info = &esirisc->jtag_info;
+	struct esirisc_trace *trace_info = &esirisc->trace_info;
+	struct esirisc_trace_stream *stream = trace_info->stream;
+	struct esirisc_trace_reader *reader = &stream->reader;
+	uint32_t buffer_cur, consumed, status;
+	int retval;
+
+	if (target->state != TARGET_HALTED)
+		return ERROR_TARGET_NOT_HALTED;
+
+	if (stream->overrun)
+		return ERROR_OK;
+
+	retval = esirisc_trace_get_status(target, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = esirisc_jtag_read_csr(jtag_info, CSR_TRACE, CSR_TRACE_BUFFER_CUR, &buffer_cur);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("%s: failed to read Trace CSR: BufferCurrent", target_name(target));
+		return retval;
+	}
+
+	if ((status & (STATUS_W | STATUS_O)) || buffer_cur < stream->address) {
+		LOG_ERROR("%s: trace buffer %s, use 'esirisc trace init' to restart",
+				target_name(target), (status & STATUS_O) ? "overflowed" : "wrapped");
+		esirisc_trace_print(&stream->sink, "--- trace data lost ---");
+		fflush(stream->sink.file);
+		stream->overrun = true;
+		return ERROR_OK;
+	}
+
+	/* drop the bytes already decoded, keeping a partial packet */
+	consumed = reader->pos / 8;
+	memmove(reader->buffer, reader->buffer + consumed, reader->size - consumed);
+	reader->size -= consumed;
+	reader->pos -= consumed * 8;
+
+	retval = esirisc_trace_stream_read(target, stream, buffer_cur);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (;;) {
+		bool end;
+
+		retval = esirisc_trace_decode(target, &stream->sink, reader, &end);
+		if (retval == ERROR_BUF_TOO_SMALL)
+			break;
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s: invalid trace data, use 'esirisc trace init' to restart",
+					target_name(target));
+			esirisc_trace_stream_reset(trace_info);
+			break;
+		}
+
+		if (end)
+			esirisc_trace_print(&stream->sink, "--- end of trace ---");
+	}
+
+	fflush(stream->sink.file);
+
+	return retval == ERROR_BUF_TOO_SMALL ? ERROR_OK : retval;
+}
+
+static int esirisc_trace_stream_event(struct target *target, enum target_event event, void *priv)
+{
+	if (priv != target || event != TARGET_EVENT_HALTED)
+		return ERROR_OK;
+
+	return esirisc_trace_stream_drain(target);
+}
+
+static void esirisc_trace_stream_stop(struct target *target)
+{
+	struct esirisc_common *esirisc = target_to_esirisc(target);
+	struct esirisc_trace *trace_info = &esirisc->trace_info;
+	struct esirisc_trace_stream *stream = trace_info->stream;
+
+	if (stream == NULL)
+		return;
+
+	target_unregister_event_callback(esirisc_trace_stream_event, target);
+
+	fclose(stream->sink.file);
+	free(stream->reader.buffer);
+	free(stream);
+
+	trace_info->stream = NULL;
+}
+
+static int esirisc_trace_stream_start(struct command_invocation *cmd, const char *filename)
+{
+	struct target *target = get_current_target(cmd->ctx);
+	struct esirisc_common *esirisc = target_to_esirisc(target);
+	struct esirisc_trace *trace_info = &esirisc->trace_info;
+	struct esirisc_trace_stream *stream;
+	uint32_t status;
+	int retval;
+
+	retval = esirisc_trace_get_status(target, &status);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the oldest data was overwritten, the next packet boundary is unknown */
+	if (status & STATUS_W) {
+		command_print(cmd, "trace buffer has wrapped, use 'esirisc trace init' first");
+		return ERROR_FAIL;
+	}
+
+	esirisc_trace_stream_stop(target);
+
+	stream = calloc(1, sizeof(struct esirisc_trace_stream));
+	if (stream == NULL) {
+		command_print(cmd, "out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* room for a full buffer plus a partial packet left from the last halt */
+	stream->reader.buffer = malloc(esirisc_trace_buffer_size(trace_info) + 8);
+	if (stream->reader.buffer == NULL) {
+		command_print(cmd, "out of memory");
+		free(stream);
+		return ERROR_FAIL;
+	}
+
+	stream->sink.file = fopen(filename, "a");
+	if (stream->sink.file == NULL) {
+		command_print(cmd, "could not open stream file: %s", filename);
+		free(stream->reader.buffer);
+		free(stream);
+		return ERROR_FAIL;
+	}
+
+	trace_info->stream = stream;
+	esirisc_trace_stream_reset(trace_info);
+
+	retval = target_register_event_callback(esirisc_trace_stream_event, target);
+	if (retval != ERROR_OK) {
+		esirisc_trace_stream_stop(target);
+		return retval;
+	}
+
+	command_print(cmd, "decoding trace at every halt to: %s", filename);
+
+	return ERROR_OK;
+}
+
+void esirisc_trace_deinit(struct target *target)
+{
+	esirisc_trace_stream_stop(target);
+}
+
 COMMAND_HANDLER(handle_esirisc_trace_init_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -862,6 +1156,34 @@ COMMAND_HANDLER(handle_esirisc_trace_dump_command)
 	}
 }
 
+COMMAND_HANDLER(handle_esirisc_trace_incremental_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct esirisc_common *esirisc = target_to_esirisc(target);
+	struct esirisc_trace *trace_info = &esirisc->trace_info;
+
+	if (!esirisc->has_trace) {
+		command_print(CMD, "target does not support trace");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (strcmp(CMD_ARGV[0], "off") == 0) {
+		esirisc_trace_stream_stop(target);
+		return ERROR_OK;
+	}
+
+	/* also see: handle_esirisc_trace_analyze_command() */
+	if (esirisc_trace_is_fifo(trace_info)) {
+		command_print(CMD, "incremental decoding from FIFO not supported");
+		return ERROR_FAIL;
+	}
+
+	return esirisc_trace_stream_start(CMD, CMD_ARGV[0]);
+}
+
 COMMAND_HANDLER(handle_esirisc_trace_buffer_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -1119,6 +1441,13 @@ static const struct command_registration esirisc_trace_exec_command_handlers[] =
 		.help = "dump collected trace data to file",
 		.usage = "[address size] filename",
 	},
+	{
+		.name = "incremental",
+		.handler = handle_esirisc_trace_incremental_command,
+		.mode = COMMAND_EXEC,
+		.help = "decode new trace data at every halt, appending to file",
+		.usage = "filename|'off'",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -69,6 +69,8 @@ enum esirisc_trace_trigger {
 	ESIRISC_TRACE_TRIGGER_LOW,
 };
 
+struct esirisc_trace_stream;
+
 struct esirisc_trace {
 	target_addr_t buffer_start;
 	target_addr_t buffer_end;
@@ -88,10 +90,14 @@ struct esirisc_trace {
 
 	enum esirisc_trace_delay delay;
 	uint32_t delay_cycles;
+
+	struct esirisc_trace_stream *stream;
 };
 
 extern const struct command_registration esirisc_trace_command_handlers[];
 
+void esirisc_trace_deinit(struct target *target);
+
 static inline uint32_t esirisc_trace_buffer_size(struct esirisc_trace *trace_info)
 {
 	return trace_info->buffer_end - trace_info->buffer_start;
@@ -156,18 +156,18 @@ struct reg_cache *etb_build_reg_cache(struct etb *etb)
 	return reg_cache;
 }
 
-static void etb_getbuf(jtag_callback_data_t arg)
-{
-	uint8_t *in = (uint8_t *)arg;
-
-	*((uint32_t *)arg) = buf_get_u32(in, 0, 32);
-}
-
+/* Read num_frames words of trace RAM. All scans go into one queue, each frame
+ * captured straight into its slot of data, and the words are put in host
+ * order in one pass once the queue has executed.
+ */
 static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 {
 	struct scan_field fields[3];
 	int i;
 
+	if (num_frames <= 0)
+		return ERROR_OK;
+
 	etb_scann(etb, 0x0);
 	etb_set_instr(etb, 0xc);
 
@@ -181,6 +181,7 @@ static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 	buf_set_u32(&temp1, 0, 7, 4);
 	fields[1].in_value = NULL;
 
+	/* nR/W remains set to read */
 	fields[2].num_bits = 1;
 	uint8_t temp2 = 0;
 	fields[2].out_value = &temp2;
@@ -189,23 +190,23 @@ static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 
 	jtag_add_dr_scan(etb->tap, 3, fields, TAP_IDLE);
 
-	for (i = 0; i < num_frames; i++) {
-		/* ensure nR/W remains set to read */
-		buf_set_u32(&temp2, 0, 1, 0);
-
-		/* address remains set to 0x4 (RAM data) until we read the last frame */
-		if (i < num_frames - 1)
-			buf_set_u32(&temp1, 0, 7, 4);
-		else
-			buf_set_u32(&temp1, 0, 7, 0);
-
+	/* address remains set to 0x4 (RAM data) until we read the last frame */
+	for (i = 0; i < num_frames - 1; i++) {
 		fields[0].in_value = (uint8_t *)(data + i);
 		jtag_add_dr_scan(etb->tap, 3, fields, TAP_IDLE);
+	}
+	buf_set_u32(&temp1, 0, 7, 0);
+	fields[0].in_value = (uint8_t *)(data + i);
+	jtag_add_dr_scan(etb->tap, 3, fields, TAP_IDLE);
 
-		jtag_add_callback(etb_getbuf, (jtag_callback_data_t)(data + i));
+	int retval = jtag_execute_queue();
+	if (retval != ERROR_OK) {
+		LOG_ERROR("ETB RAM read failed");
+		return retval;
 	}
 
-	jtag_execute_queue();
+	for (i = 0; i < num_frames; i++)
+		data[i] = le_to_h_u32((uint8_t *)(data + i));
 
 	return ERROR_OK;
 }
@@ -517,6 +518,22 @@ static trace_status_t etb_status(struct etm_context *etm_ctx)
 	return retval;
 }
 
+/* unpack one trace word of a trace RAM frame */
+static inline void etb_unpack_word(struct etmv1_trace_data *trace_data, uint32_t frame,
+		uint32_t pipestat_mask, unsigned int pipestat_shift,
+		uint32_t packet_mask, unsigned int packet_shift, unsigned int sync_bit)
+{
+	trace_data->pipestat = (frame & pipestat_mask) >> pipestat_shift;
+	trace_data->packet = (frame & packet_mask) >> packet_shift;
+	trace_data->flags = 0;
+	if ((frame >> sync_bit) & 1)
+		trace_data->flags |= ETMV1_TRACESYNC_CYCLE;
+	if (trace_data->pipestat == STAT_TR) {
+		trace_data->pipestat = trace_data->packet & 0x7;
+		trace_data->flags |= ETMV1_TRIGGER_CYCLE;
+	}
+}
+
 static int etb_read_trace(struct etm_context *etm_ctx)
 {
 	struct etb *etb = etm_ctx->capture_driver_priv;
@@ -546,7 +563,11 @@ static int etb_read_trace(struct etm_context *etm_ctx)
 
 	/* read data into temporary array for unpacking */
 	trace_data = malloc(sizeof(uint32_t) * num_frames);
-	etb_read_ram(etb, trace_data, num_frames);
+	int retval = etb_read_ram(etb, trace_data, num_frames);
+	if (retval != ERROR_OK) {
+		free(trace_data);
+		return retval;
+	}
 
 	if (etm_ctx->trace_depth > 0)
 		free(etm_ctx->trace_data);
@@ -560,86 +581,28 @@ static int etb_read_trace(struct etm_context *etm_ctx)
 
 	etm_ctx->trace_data = malloc(sizeof(struct etmv1_trace_data) * etm_ctx->trace_depth);
 
-	for (i = 0, j = 0; i < num_frames; i++) {
-		if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_4BIT) {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x78) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x80) >> 7)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 1 */
-			etm_ctx->trace_data[j + 1].pipestat = (trace_data[i] & 0x100) >> 8;
-			etm_ctx->trace_data[j + 1].packet = (trace_data[i] & 0x7800) >> 11;
-			etm_ctx->trace_data[j + 1].flags = 0;
-			if ((trace_data[i] & 0x8000) >> 15)
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 1].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				1].pipestat = etm_ctx->trace_data[j + 1].packet & 0x7;
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 2 */
-			etm_ctx->trace_data[j + 2].pipestat = (trace_data[i] & 0x10000) >> 16;
-			etm_ctx->trace_data[j + 2].packet = (trace_data[i] & 0x780000) >> 19;
-			etm_ctx->trace_data[j + 2].flags = 0;
-			if ((trace_data[i] & 0x800000) >> 23)
-				etm_ctx->trace_data[j + 2].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 2].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				2].pipestat = etm_ctx->trace_data[j + 2].packet & 0x7;
-				etm_ctx->trace_data[j + 2].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 3;
-		} else if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_8BIT) {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x7f8) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x800) >> 11)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 1 */
-			etm_ctx->trace_data[j + 1].pipestat = (trace_data[i] & 0x7000) >> 12;
-			etm_ctx->trace_data[j + 1].packet = (trace_data[i] & 0x7f8000) >> 15;
-			etm_ctx->trace_data[j + 1].flags = 0;
-			if ((trace_data[i] & 0x800000) >> 23)
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 1].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				1].pipestat = etm_ctx->trace_data[j + 1].packet & 0x7;
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 2;
-		} else {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x7fff8) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x80000) >> 19)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 1;
+	/* one loop per port width, so the field positions are constants */
+	switch (etm_ctx->control & ETM_PORT_WIDTH_MASK) {
+	case ETM_PORT_4BIT:
+		for (i = 0, j = 0; i < num_frames; i++, j += 3) {
+			etb_unpack_word(&etm_ctx->trace_data[j], trace_data[i], 0x7, 0, 0x78, 3, 7);
+			etb_unpack_word(&etm_ctx->trace_data[j + 1], trace_data[i],
+					0x100, 8, 0x7800, 11, 15);
+			etb_unpack_word(&etm_ctx->trace_data[j + 2], trace_data[i],
+					0x10000, 16, 0x780000, 19, 23);
+		}
+		break;
+	case ETM_PORT_8BIT:
+		for (i = 0, j = 0; i < num_frames; i++, j += 2) {
+			etb_unpack_word(&etm_ctx->trace_data[j], trace_data[i], 0x7, 0, 0x7f8, 3, 11);
+			etb_unpack_word(&etm_ctx->trace_data[j + 1], trace_data[i],
+					0x7000, 12, 0x7f8000, 15, 23);
 		}
+		break;
+	default:
+		for (i = 0; i < num_frames; i++)
+			etb_unpack_word(&etm_ctx->trace_data[i], trace_data[i], 0x7, 0, 0x7fff8, 3, 19);
+		break;
 	}
 
 	free(trace_data);
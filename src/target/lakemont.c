@@ -58,6 +58,7 @@ static int read_all_core_hw_regs(struct target *t);
 static int write_all_core_hw_regs(struct target *t);
 static int read_hw_reg(struct target *t,
 			int reg, uint32_t *regval, uint8_t cache);
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *regbuf);
 static int write_hw_reg(struct target *t,
 			int reg, uint32_t regval, uint8_t cache);
 static struct reg_cache *lakemont_build_reg_cache
@@ -579,6 +580,8 @@ static int do_halt(struct target *t)
 /* we need to expose the update to be able to complete the reset at SoC level */
 int lakemont_update_after_probemode_entry(struct target *t)
 {
+	/* the page tables may have changed while running */
+	x86_32_common_invalidate_tlb(t);
 	if (save_context(t) != ERROR_OK)
 		return ERROR_FAIL;
 	if (halt_prep(t) != ERROR_OK)
@@ -643,28 +646,50 @@ static int write_all_core_hw_regs(struct target *t)
 	return ERROR_OK;
 }
 
-/* read reg from lakemont core shadow ram, update reg cache if needed */
-static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
+/* queue the scans reading a reg from lakemont core shadow ram into regbuf,
+ * the value is only valid after the jtag queue has been executed */
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *regbuf)
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
-	struct lakemont_core_reg *arch_info;
-	arch_info = x86_32->cache->reg_list[reg].arch_info;
+	int flush = x86_32->flush;
+	int retval = ERROR_FAIL;
+
 	x86_32->flush = 0; /* dont flush scans till we have a batch */
 	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAM2PDR) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
+		goto out;
 	scan.out[0] = RDWRPDR;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		goto out;
+	if (drscan(t, NULL, regbuf, PDR_SIZE) != ERROR_OK)
+		goto out;
+
+	jtag_add_sleep(DELAY_SUBMITPIR);
+	retval = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	return retval;
+}
+
+/* read reg from lakemont core shadow ram, update reg cache if needed */
+static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	struct lakemont_core_reg *arch_info;
+	arch_info = x86_32->cache->reg_list[reg].arch_info;
+	uint8_t reg_buf[4];
+
+	if (queue_read_hw_reg(t, reg, reg_buf) != ERROR_OK)
 		return ERROR_FAIL;
-	if (drscan(t, NULL, scan.out, PDR_SIZE) != ERROR_OK)
+	if (jtag_execute_queue() != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return ERROR_FAIL;
+	}
 
-	jtag_add_sleep(DELAY_SUBMITPIR);
-	*regval = buf_get_u32(scan.out, 0, 32);
+	*regval = buf_get_u32(reg_buf, 0, 32);
 	if (cache) {
 		buf_set_u32(x86_32->cache->reg_list[reg].value, 0, 32, *regval);
 		x86_32->cache->reg_list[reg].valid = true;
@@ -693,19 +718,28 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 			arch_info->op,
 			regval);
 
+	/* only the final submit flushes, and not at all when the caller
+	 * is batching scans itself */
+	int flush = x86_32->flush;
 	x86_32->flush = 0; /* dont flush scans till we have a batch */
+	int retval = ERROR_FAIL;
 	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	scan.out[0] = RDWRPDR;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (drscan(t, reg_buf, scan.out, PDR_SIZE) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
+		goto out;
+	x86_32->flush = flush;
 	if (submit_instruction_pir(t, PDR2SRAM) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
+	retval = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	if (retval != ERROR_OK)
+		return retval;
 
 	/* we are writing from the cache so ensure we reset flags */
 	if (cache) {
@@ -763,9 +797,8 @@ static bool sw_bpts_supported(struct target *t)
 		return false;
 }
 
-static int transaction_status(struct target *t)
+static int check_transaction_status(struct target *t, uint32_t tapstatus)
 {
-	uint32_t tapstatus = get_tapstatus(t);
 	if ((TS_EN_PM_BIT | TS_PRDY_BIT) & tapstatus) {
 		LOG_ERROR("%s transaction error tapstatus = 0x%08" PRIx32
 				, __func__, tapstatus);
@@ -775,6 +808,31 @@ static int transaction_status(struct target *t)
 	}
 }
 
+static int transaction_status(struct target *t)
+{
+	return check_transaction_status(t, get_tapstatus(t));
+}
+
+/* queue a capture of the tap status into tapstatus, to be checked with
+ * check_transaction_status() after the jtag queue has been executed */
+static int queue_transaction_status(struct target *t, uint8_t *tapstatus)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	int flush = x86_32->flush;
+	int retval = ERROR_FAIL;
+
+	x86_32->flush = 0;
+	scan.out[0] = TAPSTATUS;
+	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		goto out;
+	if (drscan(t, NULL, tapstatus, TS_SIZE) != ERROR_OK)
+		goto out;
+	retval = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	return retval;
+}
+
 static int submit_instruction(struct target *t, int num)
 {
 	int err = submit_instruction_pir(t, num);
@@ -845,7 +903,10 @@ int lakemont_init_arch_info(struct target *t, struct x86_32_common *x86_32)
 {
 	x86_32->submit_instruction = submit_instruction;
 	x86_32->transaction_status = transaction_status;
+	x86_32->queue_transaction_status = queue_transaction_status;
+	x86_32->check_transaction_status = check_transaction_status;
 	x86_32->read_hw_reg = read_hw_reg;
+	x86_32->queue_read_hw_reg = queue_read_hw_reg;
 	x86_32->write_hw_reg = write_hw_reg;
 	x86_32->sw_bpts_supported = sw_bpts_supported;
 	x86_32->get_num_user_regs = get_num_user_regs;
@@ -22,6 +22,7 @@
 #include "config.h"
 #endif
 
+#include <helper/time_support.h>
 #include <server/telnet_server.h>
 
 #include "or1k_tap.h"
@@ -30,6 +31,13 @@
 
 static char *jsp_port;
 
+/* The JSP FIFOs move at most 8 bytes each way per transfer */
+#define JSP_XFER_SIZE		8
+/* Upper bound on back to back transfers in one poll while data is flowing */
+#define JSP_MAX_XFERS_PER_POLL	32
+/* Longest delay (in ms) between two polls of an idle JSP */
+#define JSP_MAX_POLL_INTERVAL	64
+
 /**A skim of the relevant RFCs suggests that if my application simply sent the
  * characters IAC DONT LINEMODE (\377\376\042) as soon as the client connects,
  * the client should be forced into character mode. However it doesn't make any difference.
@@ -57,22 +65,86 @@ static int telnet_write(struct connection *connection, const void *data, int len
 	return ERROR_SERVER_REMOTE_CLOSED;
 }
 
+/* Do one JSP transfer: send as much pending telnet input as fits and
+ * forward whatever the target had for us. *active is set if any byte
+ * moved in either direction.
+ */
+static int jsp_xfer(struct jsp_service *jsp_service, bool *active)
+{
+	unsigned char in_buffer[JSP_XFER_SIZE];
+	int out_len = MIN(jsp_service->tx_len, JSP_XFER_SIZE);
+	int in_len = 0;
+
+	*active = false;
+
+	int retval = or1k_adv_jtag_jsp_xfer(jsp_service->jtag_info, &out_len,
+			jsp_service->tx_buffer, &in_len, in_buffer);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (out_len > 0) {
+		jsp_service->tx_len -= out_len;
+		memmove(jsp_service->tx_buffer, jsp_service->tx_buffer + out_len,
+			jsp_service->tx_len);
+	}
+
+	if (in_len)
+		telnet_write(jsp_service->connection, in_buffer, in_len);
+
+	*active = out_len > 0 || in_len > 0;
+
+	return ERROR_OK;
+}
+
+/* Keep transferring while data is flowing, so a busy console is not
+ * limited to one FIFO worth of data per timer tick.
+ */
+static int jsp_xfer_burst(struct jsp_service *jsp_service, bool *active)
+{
+	bool moved;
+
+	*active = false;
+
+	for (int i = 0; i < JSP_MAX_XFERS_PER_POLL; i++) {
+		int retval = jsp_xfer(jsp_service, &moved);
+		if (retval != ERROR_OK)
+			return retval;
+		if (!moved)
+			break;
+		*active = true;
+	}
+
+	return ERROR_OK;
+}
+
 int jsp_poll_read(void *priv)
 {
 	struct jsp_service *jsp_service = (struct jsp_service *)priv;
-	unsigned char out_buffer[10];
-	unsigned char in_buffer[10];
-	int out_len = 0;
-	int in_len;
+	bool active;
 
 	if (!jsp_service->connection)
 		return ERROR_FAIL;
 
-	memset(out_buffer, 0, 10);
+	int64_t now = timeval_ms();
+	if (now < jsp_service->next_poll)
+		return ERROR_OK;
 
-	or1k_adv_jtag_jsp_xfer(jsp_service->jtag_info, &out_len, out_buffer, &in_len, in_buffer);
-	if (in_len)
-		telnet_write(jsp_service->connection, in_buffer, in_len);
+	int retval = jsp_xfer_burst(jsp_service, &active);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Poll on every tick while data moves or input is still queued,
+	 * back off exponentially once the JSP goes quiet.
+	 */
+	if (active || jsp_service->tx_len)
+		jsp_service->poll_interval = 0;
+	else if (jsp_service->poll_interval == 0)
+		jsp_service->poll_interval = 1;
+	else
+		jsp_service->poll_interval = MIN(jsp_service->poll_interval * 2,
+						 JSP_MAX_POLL_INTERVAL);
+
+	jsp_service->next_poll = now + jsp_service->poll_interval;
 
 	return ERROR_OK;
 }
@@ -100,6 +172,9 @@ static int jsp_new_connection(struct connection *connection)
 	}
 
 	jsp_service->connection = connection;
+	jsp_service->tx_len = 0;
+	jsp_service->poll_interval = 0;
+	jsp_service->next_poll = 0;
 
 	int retval = target_register_timer_callback(&jsp_poll_read, 1,
 		TARGET_TIMER_TYPE_PERIODIC, jsp_service);
@@ -116,6 +191,8 @@ static int jsp_input(struct connection *connection)
 	unsigned char *buf_p;
 	struct telnet_connection *t_con = connection->priv;
 	struct jsp_service *jsp_service = connection->service->priv;
+	bool active;
+	int retval;
 
 	bytes_read = connection_read(connection, buffer, TELNET_BUFFER_SIZE);
 
@@ -133,15 +210,16 @@ static int jsp_input(struct connection *connection)
 				if (*buf_p == 0xff)
 					t_con->state = TELNET_STATE_IAC;
 				else {
-					int out_len = 1;
-					int in_len;
-					unsigned char in_buffer[10];
-					or1k_adv_jtag_jsp_xfer(jsp_service->jtag_info,
-							       &out_len, buf_p, &in_len,
-							       in_buffer);
-					if (in_len)
-						telnet_write(connection,
-							     in_buffer, in_len);
+					/* Drain to the target when the queue is full */
+					if (jsp_service->tx_len == JSP_TX_BUFFER_SIZE) {
+						retval = jsp_xfer_burst(jsp_service, &active);
+						if (retval != ERROR_OK)
+							return retval;
+					}
+					if (jsp_service->tx_len < JSP_TX_BUFFER_SIZE)
+						jsp_service->tx_buffer[jsp_service->tx_len++] = *buf_p;
+					else
+						LOG_WARNING("JSP input overflow, dropping data");
 				}
 				break;
 			case TELNET_STATE_IAC:
@@ -179,6 +257,14 @@ static int jsp_input(struct connection *connection)
 		buf_p++;
 	}
 
+	/* Send it right away and poll quickly for the echo */
+	retval = jsp_xfer_burst(jsp_service, &active);
+	if (retval != ERROR_OK)
+		return retval;
+
+	jsp_service->poll_interval = 0;
+	jsp_service->next_poll = 0;
+
 	return ERROR_OK;
 }
 
@@ -207,7 +293,7 @@ static int jsp_connection_closed(struct connection *connection)
 
 int jsp_init(struct or1k_jtag *jtag_info, char *banner)
 {
-	struct jsp_service *jsp_service = malloc(sizeof(struct jsp_service));
+	struct jsp_service *jsp_service = calloc(1, sizeof(struct jsp_service));
 	jsp_service->banner = banner;
 	jsp_service->jtag_info = jtag_info;
 
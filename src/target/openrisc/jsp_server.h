@@ -5,10 +5,18 @@
 #include "or1k.h"
 #include "or1k_du.h"
 
+#define JSP_TX_BUFFER_SIZE	256
+
 struct jsp_service {
 	char *banner;
 	struct or1k_jtag *jtag_info;
 	struct connection *connection;
+	/* telnet input not yet accepted by the target JSP FIFO */
+	unsigned char tx_buffer[JSP_TX_BUFFER_SIZE];
+	int tx_len;
+	/* current delay between polls, grows while the JSP is idle */
+	int poll_interval;
+	int64_t next_poll;
 };
 
 int jsp_init(struct or1k_jtag *jtag_info, char *banner);
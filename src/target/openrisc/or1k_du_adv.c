@@ -136,6 +136,8 @@
 #define MAX_BUS_ERRORS			2
 
 #define MAX_BURST_SIZE			(4 * 1024)
+/* Bursts queued back-to-back before their CRC and status are checked */
+#define MAX_BURSTS_PER_FLUSH		8
 
 #define STATUS_BYTES			1
 #define CRC_LEN				4
@@ -144,17 +146,24 @@ static struct or1k_du or1k_du_adv;
 
 static const char * const chain_name[] = {"WISHBONE", "CPU0", "CPU1", "JSP"};
 
-static uint32_t adbg_compute_crc(uint32_t crc, uint32_t data_in,
-				 int length_bits)
+static uint32_t adbg_crc_table[256];
+
+/* The burst CRC shifts data in LSB first, so a byte at a time it is the
+ * usual reflected table driven CRC-32 (without the final inversion). */
+static uint32_t adbg_compute_crc(uint32_t crc, const uint8_t *data, int len)
 {
-	for (int i = 0; i < length_bits; i++) {
-		uint32_t d, c;
-		d = ((data_in >> i) & 0x1) ? 0xffffffff : 0;
-		c = (crc & 0x1) ? 0xffffffff : 0;
-		crc = crc >> 1;
-		crc = crc ^ ((d ^ c) & ADBG_CRC_POLY);
+	if (!adbg_crc_table[1]) {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for (int i = 0; i < 8; i++)
+				c = (c & 0x1) ? (c >> 1) ^ ADBG_CRC_POLY : c >> 1;
+			adbg_crc_table[n] = c;
+		}
 	}
 
+	for (int i = 0; i < len; i++)
+		crc = adbg_crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
 	return crc;
 }
 
@@ -414,7 +423,7 @@ static int adbg_ctrl_read(struct or1k_jtag *jtag_info, uint32_t regidx,
 	return jtag_execute_queue();
 }
 
-/* sends out a burst command to the selected module in the debug unit (MSB to LSB):
+/* queues a burst command to the selected module in the debug unit (MSB to LSB):
  * 1-bit module command
  * 4-bit opcode
  * 32-bit address
@@ -438,20 +447,14 @@ static int adbg_burst_command(struct or1k_jtag *jtag_info, uint32_t opcode,
 
 	jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
 
-	return jtag_execute_queue();
+	return ERROR_OK;
 }
 
-static int adbg_wb_burst_read(struct or1k_jtag *jtag_info, int size,
-			      int count, uint32_t start_address, uint8_t *data)
+static int adbg_burst_read_opcode(struct or1k_jtag *jtag_info, int size,
+				  uint8_t *opcode_out)
 {
-	int retry_full_crc = 0;
-	int retry_full_busy = 0;
-	int retval;
 	uint8_t opcode;
 
-	LOG_DEBUG("Doing burst read, word size %d, word count %d, start address 0x%08" PRIx32,
-		  size, count, start_address);
-
 	/* Select the appropriate opcode */
 	switch (jtag_info->or1k_jtag_module_selected) {
 	case DC_WISHBONE:
@@ -491,32 +494,155 @@ static int adbg_wb_burst_read(struct or1k_jtag *jtag_info, int size,
 		return ERROR_FAIL;
 	}
 
-	int total_size_bytes = count * size;
+	*opcode_out = opcode;
+	return ERROR_OK;
+}
+
+/* Queue a burst read command and the scan that returns its data, CRC
+ * and status; in_buffer is only valid once the queue has been executed.
+ */
+static int adbg_queue_burst_read(struct or1k_jtag *jtag_info, uint8_t opcode,
+				 int size, int count, uint32_t start_address,
+				 uint8_t *in_buffer)
+{
 	struct scan_field field;
+
+	/* Send the BURST READ command, returns TAP to idle state */
+	int retval = adbg_burst_command(jtag_info, opcode, start_address, count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	field.num_bits = (count * size + CRC_LEN + STATUS_BYTES) * 8;
+	field.out_value = NULL;
+	field.in_value = in_buffer;
+
+	jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
+
+	return ERROR_OK;
+}
+
+/* Unpack a burst read queued by adbg_queue_burst_read(). Returns
+ * ERROR_TIMEOUT_REACHED when the start bit is missing and ERROR_FAIL
+ * on a CRC mismatch.
+ */
+static int adbg_burst_read_result(uint8_t *in_buffer, int total_size_bytes,
+				  uint8_t *data)
+{
+	/* Look for the start bit in the first (STATUS_BYTES * 8) bits */
+	int shift = find_status_bit(in_buffer, STATUS_BYTES);
+
+	/* We expect the status bit to be in the first byte */
+	if (shift < 0)
+		return ERROR_TIMEOUT_REACHED;
+
+	buffer_shr(in_buffer, total_size_bytes + CRC_LEN + STATUS_BYTES, shift);
+
+	uint32_t crc_read;
+	memcpy(data, in_buffer, total_size_bytes);
+	memcpy(&crc_read, &in_buffer[total_size_bytes], 4);
+
+	uint32_t crc_calc = adbg_compute_crc(0xffffffff, data, total_size_bytes);
+
+	if (crc_calc != crc_read) {
+		LOG_WARNING("CRC ERROR! Computed 0x%08" PRIx32 ", read CRC 0x%08" PRIx32, crc_calc, crc_read);
+		return ERROR_FAIL;
+	}
+
+	LOG_DEBUG("CRC OK!");
+	return ERROR_OK;
+}
+
+/* Check the Wishbone error register after a burst. If a bus error was
+ * latched, log its address, clear the register and set *bus_error.
+ */
+static int adbg_wb_check_bus_error(struct or1k_jtag *jtag_info,
+				   const char *op, bool *bus_error)
+{
+	uint32_t err_data[2] = {0, 0};
+	uint32_t addr;
+
+	*bus_error = false;
+
+	/* First, just get 1 bit...read address only if necessary */
+	int retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (!(err_data[0] & 0x1))
+		return ERROR_OK;
+
+	/* Then we have a problem */
+	retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 33);
+	if (retval != ERROR_OK)
+		return retval;
+
+	addr = (err_data[0] >> 1) | (err_data[1] << 31);
+	LOG_WARNING("WB bus error during burst %s, address 0x%08" PRIx32 ", retrying!", op, addr);
+
+	*bus_error = true;
+
+	/* Don't call retry_do(), a JTAG reset won't help a WB bus error */
+	/* Write 1 bit, to reset the error register */
+	err_data[0] = 1;
+	return adbg_ctrl_write(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+}
+
+static bool adbg_wb_check_errors(struct or1k_jtag *jtag_info)
+{
+	return jtag_info->or1k_jtag_module_selected == DC_WISHBONE &&
+	       !(or1k_du_adv.options & ADBG_USE_HISPEED);
+}
+
+static int adbg_wb_burst_read(struct or1k_jtag *jtag_info, int size,
+			      int count, uint32_t start_address, uint8_t *data)
+{
+	int retry_full_crc = 0;
+	int retry_full_busy = 0;
+	int bus_error_retries = 0;
+	bool bus_error;
+	int retval;
+	uint8_t opcode;
+
+	LOG_DEBUG("Doing burst read, word size %d, word count %d, start address 0x%08" PRIx32,
+		  size, count, start_address);
+
+	retval = adbg_burst_read_opcode(jtag_info, size, &opcode);
+	if (retval != ERROR_OK)
+		return retval;
+
+	int total_size_bytes = count * size;
 	uint8_t *in_buffer = malloc(total_size_bytes + CRC_LEN + STATUS_BYTES);
+	if (in_buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
 
 retry_read_full:
 
-	/* Send the BURST READ command, returns TAP to idle state */
 	retval = adbg_burst_command(jtag_info, opcode, start_address, count);
 	if (retval != ERROR_OK)
 		goto out;
 
+	/* After a timeout, let the bus deliver the first word before
+	 * clocking out the data */
+	if (retry_full_busy) {
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto out;
+	}
+
+	struct scan_field field;
 	field.num_bits = (total_size_bytes + CRC_LEN + STATUS_BYTES) * 8;
 	field.out_value = NULL;
 	field.in_value = in_buffer;
-
 	jtag_add_dr_scan(jtag_info->tap, 1, &field, TAP_IDLE);
 
 	retval = jtag_execute_queue();
 	if (retval != ERROR_OK)
 		goto out;
 
-	/* Look for the start bit in the first (STATUS_BYTES * 8) bits */
-	int shift = find_status_bit(in_buffer, STATUS_BYTES);
-
-	/* We expect the status bit to be in the first byte */
-	if (shift < 0) {
+	retval = adbg_burst_read_result(in_buffer, total_size_bytes, data);
+	if (retval == ERROR_TIMEOUT_REACHED) {
 		if (retry_full_busy++ < MAX_READ_BUSY_RETRY) {
 			LOG_WARNING("Burst read timed out");
 			goto retry_read_full;
@@ -525,20 +651,7 @@ retry_read_full:
 			retval = ERROR_FAIL;
 			goto out;
 		}
-	}
-
-	buffer_shr(in_buffer, total_size_bytes + CRC_LEN + STATUS_BYTES, shift);
-
-	uint32_t crc_read;
-	memcpy(data, in_buffer, total_size_bytes);
-	memcpy(&crc_read, &in_buffer[total_size_bytes], 4);
-
-	uint32_t crc_calc = 0xffffffff;
-	for (int i = 0; i < total_size_bytes; i++)
-		crc_calc = adbg_compute_crc(crc_calc, data[i], 8);
-
-	if (crc_calc != crc_read) {
-		LOG_WARNING("CRC ERROR! Computed 0x%08" PRIx32 ", read CRC 0x%08" PRIx32, crc_calc, crc_read);
+	} else if (retval != ERROR_OK) {
 		if (retry_full_crc++ < MAX_READ_CRC_RETRY)
 			goto retry_read_full;
 		else {
@@ -546,48 +659,108 @@ retry_read_full:
 			retval = ERROR_FAIL;
 			goto out;
 		}
-	} else
-		LOG_DEBUG("CRC OK!");
+	}
 
 	/* Now, read the error register, and retry/recompute as necessary */
-	if (jtag_info->or1k_jtag_module_selected == DC_WISHBONE &&
-	    !(or1k_du_adv.options & ADBG_USE_HISPEED)) {
-
-		uint32_t err_data[2] = {0, 0};
-		uint32_t addr;
-		int bus_error_retries = 0;
-
-		/* First, just get 1 bit...read address only if necessary */
-		retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+	if (adbg_wb_check_errors(jtag_info)) {
+		retval = adbg_wb_check_bus_error(jtag_info, "read", &bus_error);
 		if (retval != ERROR_OK)
 			goto out;
 
-		/* Then we have a problem */
-		if (err_data[0] & 0x1) {
+		if (bus_error) {
+			if (++bus_error_retries > MAX_BUS_ERRORS) {
+				LOG_ERROR("Max WB bus errors reached during burst read");
+				retval = ERROR_FAIL;
+				goto out;
+			}
+			goto retry_read_full;
+		}
+	}
+
+out:
+	free(in_buffer);
+
+	return retval;
+}
+
+/* Read count words with back-to-back bursts. Up to MAX_BURSTS_PER_FLUSH
+ * bursts go out in one JTAG flush and are checked afterwards. A latched
+ * bus error redoes all bursts of the flush; otherwise only a burst that
+ * fails its status or CRC check is redone, on its own, through
+ * adbg_wb_burst_read(), which handles the retries.
+ */
+static int adbg_wb_burst_read_queued(struct or1k_jtag *jtag_info, int size,
+				     int count, uint32_t start_address, uint8_t *data)
+{
+	const int stride = MAX_BURST_SIZE * size + CRC_LEN + STATUS_BYTES;
+	uint8_t opcode;
+	bool bus_error;
+
+	int retval = adbg_burst_read_opcode(jtag_info, size, &opcode);
+	if (retval != ERROR_OK)
+		return retval;
+
+	int max_bursts = DIV_ROUND_UP(count, MAX_BURST_SIZE);
+	if (max_bursts > MAX_BURSTS_PER_FLUSH)
+		max_bursts = MAX_BURSTS_PER_FLUSH;
+
+	uint8_t *in_buffer = malloc(max_bursts * stride);
+	if (in_buffer == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	while (count > 0) {
+		int bursts = 0;
+		int words = 0;
 
-			retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 33);
+		for (; bursts < MAX_BURSTS_PER_FLUSH && words < count; bursts++) {
+			int n = MIN(count - words, MAX_BURST_SIZE);
+			retval = adbg_queue_burst_read(jtag_info, opcode, size, n,
+					start_address + words * size, in_buffer + bursts * stride);
 			if (retval != ERROR_OK)
 				goto out;
+			words += n;
+		}
 
-			addr = (err_data[0] >> 1) | (err_data[1] << 31);
-			LOG_WARNING("WB bus error during burst read, address 0x%08" PRIx32 ", retrying!", addr);
+		LOG_DEBUG("Doing %d queued burst reads, word size %d, word count %d, "
+			  "start address 0x%08" PRIx32, bursts, size, words, start_address);
 
-			bus_error_retries++;
-			if (bus_error_retries > MAX_BUS_ERRORS) {
-				LOG_ERROR("Max WB bus errors reached during burst read");
-				retval = ERROR_FAIL;
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto out;
+
+		/* A latched bus error can't be attributed to a burst: check it
+		 * before a retry below reads and clears the error register, and
+		 * redo all bursts if it is set */
+		bus_error = false;
+		if (adbg_wb_check_errors(jtag_info)) {
+			retval = adbg_wb_check_bus_error(jtag_info, "read", &bus_error);
+			if (retval != ERROR_OK)
 				goto out;
+		}
+
+		for (int i = 0; i < bursts; i++) {
+			int offset = i * MAX_BURST_SIZE;
+			int n = MIN(words - offset, MAX_BURST_SIZE);
+			uint8_t *dst = data + offset * size;
+
+			if (!bus_error) {
+				retval = adbg_burst_read_result(in_buffer + i * stride,
+						n * size, dst);
+				if (retval == ERROR_OK)
+					continue;
 			}
 
-			/* Don't call retry_do(), a JTAG reset won't help a WB bus error */
-			/* Write 1 bit, to reset the error register */
-			err_data[0] = 1;
-			retval = adbg_ctrl_write(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+			retval = adbg_wb_burst_read(jtag_info, size, n,
+					start_address + offset * size, dst);
 			if (retval != ERROR_OK)
 				goto out;
-
-			goto retry_read_full;
 		}
+
+		count -= words;
+		start_address += words * size;
+		data += words * size;
 	}
 
 out:
@@ -596,17 +769,11 @@ out:
 	return retval;
 }
 
-/* Set up and execute a burst write to a contiguous set of addresses */
-static int adbg_wb_burst_write(struct or1k_jtag *jtag_info, const uint8_t *data, int size,
-			int count, unsigned long start_address)
+static int adbg_burst_write_opcode(struct or1k_jtag *jtag_info, int size,
+				   uint8_t *opcode_out)
 {
-	int retry_full_crc = 0;
-	int retval;
 	uint8_t opcode;
 
-	LOG_DEBUG("Doing burst write, word size %d, word count %d,"
-		  "start address 0x%08lx", size, count, start_address);
-
 	/* Select the appropriate opcode */
 	switch (jtag_info->or1k_jtag_module_selected) {
 	case DC_WISHBONE:
@@ -646,10 +813,19 @@ static int adbg_wb_burst_write(struct or1k_jtag *jtag_info, const uint8_t *data,
 		return ERROR_FAIL;
 	}
 
-retry_full_write:
+	*opcode_out = opcode;
+	return ERROR_OK;
+}
 
+/* Queue a burst write command, its data and CRC, and the scan that
+ * returns the 'CRC match' bit into *match.
+ */
+static int adbg_queue_burst_write(struct or1k_jtag *jtag_info, uint8_t opcode,
+				  const uint8_t *data, int size, int count,
+				  uint32_t start_address, uint8_t *match)
+{
 	/* Send the BURST WRITE command, returns TAP to idle state */
-	retval = adbg_burst_command(jtag_info, opcode, start_address, count);
+	int retval = adbg_burst_command(jtag_info, opcode, start_address, count);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -661,9 +837,7 @@ retry_full_write:
 	field[0].out_value = &value;
 	field[0].in_value = NULL;
 
-	uint32_t crc_calc = 0xffffffff;
-	for (int i = 0; i < (count * size); i++)
-		crc_calc = adbg_compute_crc(crc_calc, data[i], 8);
+	uint32_t crc_calc = adbg_compute_crc(0xffffffff, data, count * size);
 
 	field[1].num_bits = count * size * 8;
 	field[1].out_value = data;
@@ -678,15 +852,44 @@ retry_full_write:
 	/* Read the 'CRC match' bit, and go to idle */
 	field[0].num_bits = 1;
 	field[0].out_value = NULL;
-	field[0].in_value = &value;
+	field[0].in_value = match;
 	jtag_add_dr_scan(jtag_info->tap, 1, field, TAP_IDLE);
 
+	return ERROR_OK;
+}
+
+/* Set up and execute a burst write to a contiguous set of addresses */
+static int adbg_wb_burst_write(struct or1k_jtag *jtag_info, const uint8_t *data, int size,
+			int count, unsigned long start_address)
+{
+	int retry_full_crc = 0;
+	int bus_error_retries = 0;
+	bool bus_error;
+	int retval;
+	uint8_t opcode;
+	uint8_t match;
+
+	LOG_DEBUG("Doing burst write, word size %d, word count %d,"
+		  "start address 0x%08lx", size, count, start_address);
+
+	retval = adbg_burst_write_opcode(jtag_info, size, &opcode);
+	if (retval != ERROR_OK)
+		return retval;
+
+retry_full_write:
+
+	match = 0;
+	retval = adbg_queue_burst_write(jtag_info, opcode, data, size, count,
+			start_address, &match);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = jtag_execute_queue();
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (!value) {
-		LOG_WARNING("CRC ERROR! match bit after write is %" PRIi8 " (computed CRC 0x%08" PRIx32 ")", value, crc_calc);
+	if (!(match & 0x1)) {
+		LOG_WARNING("CRC ERROR! match bit after write is %" PRIi8, match);
 		if (retry_full_crc++ < MAX_WRITE_CRC_RETRY)
 			goto retry_full_write;
 		else
@@ -695,43 +898,85 @@ retry_full_write:
 		LOG_DEBUG("CRC OK!\n");
 
 	/* Now, read the error register, and retry/recompute as necessary */
-	if (jtag_info->or1k_jtag_module_selected == DC_WISHBONE &&
-	    !(or1k_du_adv.options & ADBG_USE_HISPEED)) {
-		uint32_t addr;
-		int bus_error_retries = 0;
-		uint32_t err_data[2] = {0, 0};
-
-		/* First, just get 1 bit...read address only if necessary */
-		retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+	if (adbg_wb_check_errors(jtag_info)) {
+		retval = adbg_wb_check_bus_error(jtag_info, "write", &bus_error);
 		if (retval != ERROR_OK)
 			return retval;
 
-		/* Then we have a problem */
-		if (err_data[0] & 0x1) {
+		if (bus_error) {
+			if (++bus_error_retries > MAX_BUS_ERRORS) {
+				LOG_ERROR("Max WB bus errors reached during burst write");
+				return ERROR_FAIL;
+			}
+			goto retry_full_write;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* Write count words with back-to-back bursts, verifying the 'CRC match'
+ * bits of up to MAX_BURSTS_PER_FLUSH bursts after a single flush. A burst
+ * that did not match is redone on its own through adbg_wb_burst_write().
+ */
+static int adbg_wb_burst_write_queued(struct or1k_jtag *jtag_info, const uint8_t *data,
+				      int size, int count, uint32_t start_address)
+{
+	uint8_t match[MAX_BURSTS_PER_FLUSH];
+	uint8_t opcode;
+	bool bus_error;
 
-			retval = adbg_ctrl_read(jtag_info, DBG_WB_REG_ERROR, err_data, 33);
+	int retval = adbg_burst_write_opcode(jtag_info, size, &opcode);
+	if (retval != ERROR_OK)
+		return retval;
+
+	while (count > 0) {
+		int bursts = 0;
+		int words = 0;
+
+		for (; bursts < MAX_BURSTS_PER_FLUSH && words < count; bursts++) {
+			int n = MIN(count - words, MAX_BURST_SIZE);
+			match[bursts] = 0;
+			retval = adbg_queue_burst_write(jtag_info, opcode, data + words * size,
+					size, n, start_address + words * size, &match[bursts]);
 			if (retval != ERROR_OK)
 				return retval;
+			words += n;
+		}
 
-			addr = (err_data[0] >> 1) | (err_data[1] << 31);
-			LOG_WARNING("WB bus error during burst write, address 0x%08" PRIx32 ", retrying!", addr);
+		LOG_DEBUG("Doing %d queued burst writes, word size %d, word count %d, "
+			  "start address 0x%08" PRIx32, bursts, size, words, start_address);
 
-			bus_error_retries++;
-			if (bus_error_retries > MAX_BUS_ERRORS) {
-				LOG_ERROR("Max WB bus errors reached during burst read");
-				retval = ERROR_FAIL;
-				return retval;
-			}
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			return retval;
 
-			/* Don't call retry_do(), a JTAG reset won't help a WB bus error */
-			/* Write 1 bit, to reset the error register */
-			err_data[0] = 1;
-			retval = adbg_ctrl_write(jtag_info, DBG_WB_REG_ERROR, err_data, 1);
+		/* A latched bus error can't be attributed to a burst: redo them all */
+		bus_error = false;
+		if (adbg_wb_check_errors(jtag_info)) {
+			retval = adbg_wb_check_bus_error(jtag_info, "write", &bus_error);
 			if (retval != ERROR_OK)
 				return retval;
+		}
 
-			goto retry_full_write;
+		for (int i = 0; i < bursts; i++) {
+			int offset = i * MAX_BURST_SIZE;
+
+			if (!bus_error && (match[i] & 0x1))
+				continue;
+
+			if (!bus_error)
+				LOG_WARNING("CRC ERROR! match bit after queued write is %" PRIi8, match[i]);
+			retval = adbg_wb_burst_write(jtag_info, data + offset * size, size,
+					MIN(words - offset, MAX_BURST_SIZE),
+					start_address + offset * size);
+			if (retval != ERROR_OK)
+				return retval;
 		}
+
+		count -= words;
+		start_address += words * size;
+		data += words * size;
 	}
 
 	return ERROR_OK;
@@ -882,24 +1127,9 @@ static int or1k_adv_jtag_read_memory(struct or1k_jtag *jtag_info,
 	if (retval != ERROR_OK)
 		return retval;
 
-	int block_count_left = count;
-	uint32_t block_count_address = addr;
-	uint8_t *block_count_buffer = buffer;
-
-	while (block_count_left) {
-
-		int blocks_this_round = (block_count_left > MAX_BURST_SIZE) ?
-			MAX_BURST_SIZE : block_count_left;
-
-		retval = adbg_wb_burst_read(jtag_info, size, blocks_this_round,
-					    block_count_address, block_count_buffer);
-		if (retval != ERROR_OK)
-			return retval;
-
-		block_count_left -= blocks_this_round;
-		block_count_address += size * MAX_BURST_SIZE;
-		block_count_buffer += size * MAX_BURST_SIZE;
-	}
+	retval = adbg_wb_burst_read_queued(jtag_info, size, count, addr, buffer);
+	if (retval != ERROR_OK)
+		return retval;
 
 	/* The adv_debug_if always return words and half words in
 	 * little-endian order no matter what the target endian is.
@@ -962,33 +1192,12 @@ static int or1k_adv_jtag_write_memory(struct or1k_jtag *jtag_info,
 		buffer = t;
 	}
 
-	int block_count_left = count;
-	uint32_t block_count_address = addr;
-	uint8_t *block_count_buffer = (uint8_t *)buffer;
-
-	while (block_count_left) {
-
-		int blocks_this_round = (block_count_left > MAX_BURST_SIZE) ?
-			MAX_BURST_SIZE : block_count_left;
-
-		retval = adbg_wb_burst_write(jtag_info, block_count_buffer,
-					     size, blocks_this_round,
-					     block_count_address);
-		if (retval != ERROR_OK) {
-			if (t != NULL)
-				free(t);
-			return retval;
-		}
-
-		block_count_left -= blocks_this_round;
-		block_count_address += size * MAX_BURST_SIZE;
-		block_count_buffer += size * MAX_BURST_SIZE;
-	}
+	retval = adbg_wb_burst_write_queued(jtag_info, buffer, size, count, addr);
 
 	if (t != NULL)
 		free(t);
 
-	return ERROR_OK;
+	return retval;
 }
 
 int or1k_adv_jtag_jsp_xfer(struct or1k_jtag *jtag_info,
@@ -998,8 +1207,11 @@ int or1k_adv_jtag_jsp_xfer(struct or1k_jtag *jtag_info,
 	LOG_DEBUG("JSP transfert");
 
 	int retval;
-	if (!jtag_info->or1k_jtag_inited)
+	*in_len = 0;
+	if (!jtag_info->or1k_jtag_inited) {
+		*out_len = 0;
 		return ERROR_OK;
+	}
 
 	retval = adbg_select_module(jtag_info, DC_JSP);
 	if (retval != ERROR_OK)
@@ -1067,6 +1279,8 @@ int or1k_adv_jtag_jsp_xfer(struct or1k_jtag *jtag_info,
 
 	/* bytes available is in the upper nibble */
 	*in_len = (in_data[0] >> 4) & 0xF;
+	if (*in_len > 8)
+		*in_len = 8;
 	memcpy(in_buffer, &in_data[1], *in_len);
 
 	int bytes_free = in_data[0] & 0x0F;
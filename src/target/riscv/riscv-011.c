@@ -585,19 +585,25 @@ static int scans_execute(scans_t *scans)
 	return ERROR_OK;
 }
 
-/** Add a 32-bit dbus write to the scans structure. */
-static void scans_add_write32(scans_t *scans, uint16_t address, uint32_t data,
-		bool set_interrupt)
+/** Add a dbus write of a raw 34-bit value to the scans structure. */
+static void scans_add_write(scans_t *scans, uint16_t address, uint64_t data)
 {
 	const unsigned int i = scans->next_scan;
 	int data_offset = scans->scan_size * i;
 	add_dbus_scan(scans->target, &scans->field[i], scans->out + data_offset,
-			scans->in + data_offset, DBUS_OP_WRITE, address,
-			(set_interrupt ? DMCONTROL_INTERRUPT : 0) | DMCONTROL_HALTNOT | data);
+			scans->in + data_offset, DBUS_OP_WRITE, address, data);
 	scans->next_scan++;
 	assert(scans->next_scan <= scans->scan_count);
 }
 
+/** Add a 32-bit dbus write to the scans structure. */
+static void scans_add_write32(scans_t *scans, uint16_t address, uint32_t data,
+		bool set_interrupt)
+{
+	scans_add_write(scans, address,
+			(set_interrupt ? DMCONTROL_INTERRUPT : 0) | DMCONTROL_HALTNOT | data);
+}
+
 /** Add a 32-bit dbus write for an instruction that jumps to the beginning of
  * debug RAM. */
 static void scans_add_write_jump(scans_t *scans, uint16_t address,
@@ -665,6 +671,31 @@ static uint64_t scans_get_u64(scans_t *scans, unsigned int index,
 	return buf_get_u64(scans->in + scans->scan_size * index, first, num);
 }
 
+/** Check the status of every executed scan. Returns ERROR_FAIL on a
+ * failed or invalid access, and counts busy ones in *busy. */
+static int scans_check_status(scans_t *scans, unsigned int *busy)
+{
+	*busy = 0;
+	for (unsigned int i = 0; i < scans->next_scan; i++) {
+		dbus_status_t status = scans_get_u32(scans, i, DBUS_OP_START,
+				DBUS_OP_SIZE);
+		switch (status) {
+			case DBUS_STATUS_SUCCESS:
+				break;
+			case DBUS_STATUS_FAILED:
+				LOG_ERROR("Debug RAM access failed. Hardware error?");
+				return ERROR_FAIL;
+			case DBUS_STATUS_BUSY:
+				(*busy)++;
+				break;
+			default:
+				LOG_ERROR("Got invalid bus access status: %d", status);
+				return ERROR_FAIL;
+		}
+	}
+	return ERROR_OK;
+}
+
 /*** end of scans class ***/
 
 static uint32_t dram_read32(struct target *target, unsigned int index)
@@ -748,6 +779,41 @@ static int wait_for_debugint_clear(struct target *target, bool ignore_first)
 	}
 }
 
+/** Write words 0 through count-1 of Debug RAM in a single flush. If the
+ * dbus was busy for any of them, that write was ignored, so fall back to
+ * writing each word with its own checked scan. Only once all words are known
+ * to be in place is the raw dbus value last_value written to Debug RAM word
+ * last_index, since that write usually sets the debug interrupt. */
+static int dram_write_program(struct target *target, const uint32_t *program,
+		unsigned int count, unsigned int last_index, uint64_t last_value)
+{
+	scans_t *scans = scans_new(target, count);
+	if (!scans)
+		return ERROR_FAIL;
+
+	for (unsigned int i = 0; i < count; i++)
+		scans_add_write32(scans, dram_address(i), program[i], false);
+
+	unsigned int busy;
+	int retval = scans_execute(scans);
+	if (retval == ERROR_OK)
+		retval = scans_check_status(scans, &busy);
+	scans_delete(scans);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (busy) {
+		increase_dbus_busy_delay(target);
+
+		for (unsigned int i = 0; i < count; i++)
+			dram_write32(target, i, program[i], false);
+	}
+
+	dbus_write(target, dram_address(last_index), last_value);
+
+	return ERROR_OK;
+}
+
 static int dram_check32(struct target *target, unsigned int index,
 		uint32_t expected)
 {
@@ -839,8 +905,53 @@ static int cache_check(struct target *target)
 	riscv011_info_t *info = get_info(target);
 	int error = 0;
 
+	/* Read back every clean word in one flush. A dbus read returns the
+	 * data of the previous read, so the result for word i shows up in
+	 * the scan after the one that asked for it. */
+	scans_t *scans = scans_new(target, info->dramsize + 1);
+	if (!scans)
+		return ERROR_FAIL;
+
+	unsigned int checked[DRAM_CACHE_SIZE];
+	unsigned int count = 0;
 	for (unsigned int i = 0; i < info->dramsize; i++) {
 		if (info->dram_cache[i].valid && !info->dram_cache[i].dirty) {
+			scans_add_read32(scans, dram_address(i), false);
+			checked[count++] = i;
+		}
+	}
+	scans_add_read32(scans, DMCONTROL, false);
+
+	unsigned int busy;
+	int retval = scans_execute(scans);
+	if (retval == ERROR_OK)
+		retval = scans_check_status(scans, &busy);
+	if (retval != ERROR_OK) {
+		scans_delete(scans);
+		return retval;
+	}
+
+	for (unsigned int j = 0; j < count && !busy; j++) {
+		unsigned int i = checked[j];
+		uint16_t address_in = scans_get_u32(scans, j + 1, DBUS_ADDRESS_START,
+				info->addrbits);
+		uint32_t actual = scans_get_u32(scans, j + 1, DBUS_DATA_START, 32);
+		if (address_in != dram_address(i)) {
+			/* Unexpected response; let the careful path sort it out. */
+			busy = 1;
+		} else if (actual != info->dram_cache[i].data) {
+			LOG_ERROR("Wrote 0x%x to Debug RAM at %d, but read back 0x%x",
+					info->dram_cache[i].data, i, actual);
+			error++;
+		}
+	}
+	scans_delete(scans);
+
+	if (busy) {
+		increase_dbus_busy_delay(target);
+		error = 0;
+		for (unsigned int j = 0; j < count; j++) {
+			unsigned int i = checked[j];
 			if (dram_check32(target, i, info->dram_cache[i].data) != ERROR_OK)
 				error++;
 		}
@@ -1005,14 +1116,11 @@ static uint64_t cache_get(struct target *target, slot_t slot)
 	return value;
 }
 
-/* Write instruction that jumps from the specified word in Debug RAM to resume
- * in Debug ROM. */
-static void dram_write_jump(struct target *target, unsigned int index,
-		bool set_interrupt)
+/* Instruction that jumps from the specified word in Debug RAM to resume in
+ * Debug ROM. */
+static uint32_t dram_jump(unsigned int index)
 {
-	dram_write32(target, index,
-			jal(0, (uint32_t) (DEBUG_ROM_RESUME - (DEBUG_RAM_START + 4*index))),
-			set_interrupt);
+	return jal(0, (uint32_t) (DEBUG_ROM_RESUME - (DEBUG_RAM_START + 4*index)));
 }
 
 static int wait_for_state(struct target *target, enum target_state state)
@@ -1146,14 +1254,17 @@ static int execute_resume(struct target *target, bool step)
 	else
 		info->dcsr &= ~DCSR_STEP;
 
-	dram_write32(target, 0, lw(S0, ZERO, DEBUG_RAM_START + 16), false);
-	dram_write32(target, 1, csrw(S0, CSR_DCSR), false);
-	dram_write32(target, 2, fence_i(), false);
-	dram_write_jump(target, 3, false);
+	const uint32_t program[] = {
+		lw(S0, ZERO, DEBUG_RAM_START + 16),
+		csrw(S0, CSR_DCSR),
+		fence_i(),
+		dram_jump(3)
+	};
 
 	/* Write DCSR value, set interrupt and clear haltnot. */
 	uint64_t dbus_value = DMCONTROL_INTERRUPT | info->dcsr;
-	dbus_write(target, dram_address(4), dbus_value);
+	if (dram_write_program(target, program, DIM(program), 4, dbus_value) != ERROR_OK)
+		return ERROR_FAIL;
 
 	cache_invalidate(target);
 
@@ -1962,11 +2073,15 @@ static int assert_reset(struct target *target)
 		info->dcsr |= DCSR_NDRESET;
 	else
 		info->dcsr |= DCSR_FULLRESET;
-	dram_write32(target, 0, lw(S0, ZERO, DEBUG_RAM_START + 16), false);
-	dram_write32(target, 1, csrw(S0, CSR_DCSR), false);
-	/* We shouldn't actually need the jump because a reset should happen. */
-	dram_write_jump(target, 2, false);
-	dram_write32(target, 4, info->dcsr, true);
+	const uint32_t program[] = {
+		lw(S0, ZERO, DEBUG_RAM_START + 16),
+		csrw(S0, CSR_DCSR),
+		/* We shouldn't actually need the jump because a reset should happen. */
+		dram_jump(2)
+	};
+	uint64_t dbus_value = DMCONTROL_INTERRUPT | DMCONTROL_HALTNOT | info->dcsr;
+	if (dram_write_program(target, program, DIM(program), 4, dbus_value) != ERROR_OK)
+		return ERROR_FAIL;
 	cache_invalidate(target);
 
 	target->state = TARGET_RESET;
@@ -2012,7 +2127,8 @@ static int read_memory(struct target *target, target_addr_t address,
 			return ERROR_FAIL;
 	}
 	cache_set_jump(target, 3);
-	cache_write(target, CACHE_NO_READ, false);
+	if (cache_write(target, CACHE_NO_READ, false) != ERROR_OK)
+		return ERROR_FAIL;
 
 	riscv011_info_t *info = get_info(target);
 	const unsigned max_batch_size = 256;
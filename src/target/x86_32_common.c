@@ -34,6 +34,7 @@
 #endif
 
 #include <helper/log.h>
+#include <jtag/jtag.h>
 
 #include "target.h"
 #include "target_type.h"
@@ -41,13 +42,20 @@
 #include "breakpoints.h"
 #include "x86_32_common.h"
 
+/* probe mode memory accesses queued per jtag queue execution */
+#define MEM_ACCESS_BLOCK	64
+
 static int set_debug_regs(struct target *t, uint32_t address,
 			uint8_t bp_num, uint8_t bp_type, uint8_t bp_length);
 static int unset_debug_regs(struct target *t, uint8_t bp_num);
 static int read_mem(struct target *t, uint32_t size,
-			uint32_t addr, uint8_t *buf);
+			uint32_t addr, uint8_t *regbuf, uint8_t *status);
 static int write_mem(struct target *t, uint32_t size,
-			uint32_t addr, const uint8_t *buf);
+			uint32_t addr, const uint8_t *buf, uint8_t *status);
+static int read_mem_block(struct target *t, uint32_t size,
+			uint32_t addr, uint32_t count, uint8_t *buf);
+static int write_mem_block(struct target *t, uint32_t size,
+			uint32_t addr, uint32_t count, const uint8_t *buf);
 static int calcaddr_physfromlin(struct target *t, target_addr_t addr,
 			target_addr_t *physaddr);
 static int read_phys_mem(struct target *t, uint32_t phys_address,
@@ -102,6 +110,7 @@ int x86_32_common_init_arch_info(struct target *t, struct x86_32_common *x86_32)
 	x86_32->curr_tap = t->tap;
 	x86_32->fast_data_area = NULL;
 	x86_32->flush = 1;
+	x86_32_common_invalidate_tlb(t);
 	x86_32->read_hw_reg_to_cache = read_hw_reg_to_cache;
 	x86_32->write_hw_reg_from_cache = write_hw_reg_from_cache;
 	return ERROR_OK;
@@ -194,21 +203,9 @@ static int read_phys_mem(struct target *t, uint32_t phys_address,
 		pg_disabled = true;
 	}
 
-	for (uint32_t i = 0; i < count; i++) {
-		switch (size) {
-		case BYTE:
-			retval = read_mem(t, size, phys_address + i, buffer + i);
-			break;
-		case WORD:
-			retval = read_mem(t, size, phys_address + i * 2, buffer + i * 2);
-			break;
-		case DWORD:
-			retval = read_mem(t, size, phys_address + i * 4, buffer + i * 4);
-			break;
-		default:
-			LOG_ERROR("%s invalid read size", __func__);
-			break;
-		}
+	for (uint32_t i = 0; i < count; i += MEM_ACCESS_BLOCK) {
+		retval = read_mem_block(t, size, phys_address + i * size,
+				MIN(count - i, MEM_ACCESS_BLOCK), buffer + i * size);
 		if (retval != ERROR_OK)
 			break;
 	}
@@ -227,7 +224,8 @@ static int read_phys_mem(struct target *t, uint32_t phys_address,
 	return retval;
 }
 
-int x86_32_common_write_phys_mem(struct target *t, target_addr_t phys_address,
+/* write physical memory, keeping the software breakpoints in place */
+static int write_phys_mem_swbp(struct target *t, target_addr_t phys_address,
 			uint32_t size, uint32_t count, const uint8_t *buffer)
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
@@ -271,6 +269,15 @@ int x86_32_common_write_phys_mem(struct target *t, target_addr_t phys_address,
 	return error;
 }
 
+int x86_32_common_write_phys_mem(struct target *t, target_addr_t phys_address,
+			uint32_t size, uint32_t count, const uint8_t *buffer)
+{
+	int error = write_phys_mem_swbp(t, phys_address, size, count, buffer);
+	/* the write may have hit the page tables */
+	x86_32_common_invalidate_tlb(t);
+	return error;
+}
+
 static int write_phys_mem(struct target *t, uint32_t phys_address,
 			uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -301,35 +308,27 @@ static int write_phys_mem(struct target *t, uint32_t phys_address,
 		}
 		pg_disabled = true;
 	}
-	for (uint32_t i = 0; i < count; i++) {
-		switch (size) {
-		case BYTE:
-			retval = write_mem(t, size, phys_address + i, buffer + i);
-			break;
-		case WORD:
-			retval = write_mem(t, size, phys_address + i * 2, buffer + i * 2);
-			break;
-		case DWORD:
-			retval = write_mem(t, size, phys_address + i * 4, buffer + i * 4);
-			break;
-		default:
-			LOG_DEBUG("invalid read size");
+	for (uint32_t i = 0; i < count; i += MEM_ACCESS_BLOCK) {
+		retval = write_mem_block(t, size, phys_address + i * size,
+				MIN(count - i, MEM_ACCESS_BLOCK), buffer + i * size);
+		if (retval != ERROR_OK)
 			break;
-		}
 	}
 	/* restore CR0.PG bit if needed (regardless of retval) */
 	if (pg_disabled) {
-		retval = x86_32->enable_paging(t);
-		if (retval != ERROR_OK) {
+		int retval2 = x86_32->enable_paging(t);
+		if (retval2 != ERROR_OK) {
 			LOG_ERROR("%s could not enable paging", __func__);
-			return retval;
+			return retval2;
 		}
 	}
 	return retval;
 }
 
+/* queue a probe mode memory read, the value read ends up in regbuf (EDX)
+ * and the tap status in status when the jtag queue is executed */
 static int read_mem(struct target *t, uint32_t size,
-			uint32_t addr, uint8_t *buf)
+			uint32_t addr, uint8_t *regbuf, uint8_t *status)
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
 
@@ -362,35 +361,25 @@ static int read_mem(struct target *t, uint32_t size,
 			break;
 		default:
 			LOG_ERROR("%s invalid read mem size", __func__);
-			break;
+			return ERROR_FAIL;
 	}
 
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* read_hw_reg() will write to 4 bytes (uint32_t)
-	 * Watch out, the buffer passed into read_mem() might be 1 or 2 bytes.
-	 */
-	uint32_t regval;
-	retval = x86_32->read_hw_reg(t, EDX, &regval, 0);
-
+	retval = x86_32->queue_read_hw_reg(t, EDX, regbuf);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("%s error read EDX", __func__);
 		return retval;
 	}
-	for (uint8_t i = 0; i < size; i++)
-		buf[i] = (regval >> (i*8)) & 0x000000FF;
 
-	retval = x86_32->transaction_status(t);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("%s error on mem read", __func__);
-		return retval;
-	}
-	return retval;
+	return x86_32->queue_transaction_status(t, status);
 }
 
+/* queue a probe mode memory write, the tap status ends up in status when
+ * the jtag queue is executed */
 static int write_mem(struct target *t, uint32_t size,
-			uint32_t addr, const uint8_t *buf)
+			uint32_t addr, const uint8_t *buf, uint8_t *status)
 {
 	uint32_t i = 0;
 	uint32_t buf4bytes = 0;
@@ -444,32 +433,118 @@ static int write_mem(struct target *t, uint32_t size,
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = x86_32->transaction_status(t);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("%s error on mem write", __func__);
+	return x86_32->queue_transaction_status(t, status);
+}
+
+/* Queue the probe mode instructions of count reads with flushing disabled,
+ * execute the jtag queue once and then check the captured status of each
+ * read. This turns half a dozen round trips per access into one per block.
+ */
+static int read_mem_block(struct target *t, uint32_t size,
+			uint32_t addr, uint32_t count, uint8_t *buf)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t regbuf[MEM_ACCESS_BLOCK][4];
+	uint8_t status[MEM_ACCESS_BLOCK][4];
+	int retval = ERROR_OK;
+
+	x86_32->flush = 0;
+	for (uint32_t i = 0; i < count && retval == ERROR_OK; i++)
+		retval = read_mem(t, size, addr + i * size, regbuf[i], status[i]);
+	x86_32->flush = 1;
+
+	/* run what was queued even on error, so it doesn't end up in the next flush */
+	int retval2 = jtag_execute_queue();
+	if (retval != ERROR_OK)
 		return retval;
+	if (retval2 != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		return retval2;
 	}
-	return retval;
+
+	for (uint32_t i = 0; i < count; i++) {
+		retval = x86_32->check_transaction_status(t, buf_get_u32(status[i], 0, 32));
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error on mem read at 0x%08" PRIx32, __func__, addr + i * size);
+			return retval;
+		}
+		/* EDX is 4 bytes, the access might be 1 or 2 bytes */
+		uint32_t regval = buf_get_u32(regbuf[i], 0, 32);
+		for (uint8_t j = 0; j < size; j++)
+			buf[i * size + j] = (regval >> (j*8)) & 0x000000FF;
+	}
+	return ERROR_OK;
 }
 
-int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *physaddr)
+/* like read_mem_block(), for writes */
+static int write_mem_block(struct target *t, uint32_t size,
+			uint32_t addr, uint32_t count, const uint8_t *buf)
 {
-	uint8_t entry_buffer[8];
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t status[MEM_ACCESS_BLOCK][4];
+	int retval = ERROR_OK;
 
-	if (physaddr == NULL || t == NULL)
-		return ERROR_FAIL;
+	x86_32->flush = 0;
+	for (uint32_t i = 0; i < count && retval == ERROR_OK; i++)
+		retval = write_mem(t, size, addr + i * size, buf + i * size, status[i]);
+	x86_32->flush = 1;
 
+	int retval2 = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+	if (retval2 != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		return retval2;
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		retval = x86_32->check_transaction_status(t, buf_get_u32(status[i], 0, 32));
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error on mem write at 0x%08" PRIx32, __func__, addr + i * size);
+			return retval;
+		}
+	}
+	return ERROR_OK;
+}
+
+void x86_32_common_invalidate_tlb(struct target *t)
+{
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	for (unsigned int i = 0; i < X86_32_TLB_SIZE; i++)
+		x86_32->tlb[i].valid = false;
+	x86_32->tlb_next = 0;
+}
 
-	/* The 'user-visible' CR0.PG should be set - otherwise the function shouldn't be called
-	 * (Don't check the CR0.PG on the target, this might be temporally disabled at this point)
-	 */
-	uint32_t cr0 = buf_get_u32(x86_32->cache->reg_list[CR0].value, 0, 32);
-	if (!(cr0 & CR0_PG)) {
-		/* you are wrong in this function, never mind */
-		*physaddr = addr;
-		return ERROR_OK;
+static void tlb_insert(struct x86_32_common *x86_32, uint32_t lin,
+			uint32_t phys, uint32_t mask)
+{
+	struct x86_32_tlb_entry *entry = &x86_32->tlb[x86_32->tlb_next];
+	x86_32->tlb_next = (x86_32->tlb_next + 1) % X86_32_TLB_SIZE;
+	entry->valid = true;
+	entry->lin = lin & ~mask;
+	entry->phys = phys & ~mask;
+	entry->mask = mask;
+}
+
+static struct x86_32_tlb_entry *tlb_lookup(struct x86_32_common *x86_32, uint32_t addr)
+{
+	for (unsigned int i = 0; i < X86_32_TLB_SIZE; i++) {
+		struct x86_32_tlb_entry *entry = &x86_32->tlb[i];
+		if (entry->valid && (addr & ~entry->mask) == entry->lin)
+			return entry;
 	}
+	return NULL;
+}
+
+/* Walk the page tables for addr and add the translation to the cache. For
+ * 4KB pages the entries of the following pages in the same page table are
+ * read along with it, so a transfer crossing pages walks the tables once.
+ */
+static int walk_page_tables(struct target *t, uint32_t addr, uint32_t *page_base,
+			uint32_t *page_mask)
+{
+	uint8_t entry_buffer[8 * X86_32_TLB_PREFETCH];
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
 
 	uint32_t cr4 = buf_get_u32(x86_32->cache->reg_list[CR4].value, 0, 32);
 	bool isPAE = cr4 & 0x00000020; /* PAE - Physical Address Extension */
@@ -509,17 +584,16 @@ int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *ph
 		/* PS bit in PD entry is indicating 4KB or 2MB page size */
 		if (pd_entry & 0x0000000000000080) {
 
-			uint32_t page_base = (uint32_t)(pd_entry & 0x00000000FFE00000); /* [31:21] */
-			uint32_t offset = addr & 0x001FFFFF; /* [20:0] */
-			*physaddr = page_base + offset;
-			return ERROR_OK;
+			*page_base = (uint32_t)(pd_entry & 0x00000000FFE00000); /* [31:21] */
+			*page_mask = 0x001FFFFF; /* [20:0] */
 
 		} else {
 
 			uint32_t pt_base = (uint32_t)(pd_entry & 0x00000000FFFFF000); /*[31:12]*/
 			uint32_t pt_index = (addr & 0x001FF000) >> 12; /*[20:12]*/
 			uint32_t pt_addr = pt_base + (8 * pt_index);
-			if (x86_32_common_read_phys_mem(t, pt_addr, 4, 2, entry_buffer) != ERROR_OK) {
+			uint32_t n = MIN(X86_32_TLB_PREFETCH, 512 - pt_index);
+			if (x86_32_common_read_phys_mem(t, pt_addr, 4, 2 * n, entry_buffer) != ERROR_OK) {
 				LOG_ERROR("%s couldn't read page table entry at 0x%08" PRIx32, __func__, pt_addr);
 				return ERROR_FAIL;
 			}
@@ -529,10 +603,15 @@ int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *ph
 				return ERROR_FAIL;
 			}
 
-			uint32_t page_base = (uint32_t)(pt_entry & 0x00000000FFFFF000); /*[31:12]*/
-			uint32_t offset =  addr & 0x00000FFF; /*[11:0]*/
-			*physaddr = page_base + offset;
-			return ERROR_OK;
+			*page_base = (uint32_t)(pt_entry & 0x00000000FFFFF000); /*[31:12]*/
+			*page_mask = 0x00000FFF; /*[11:0]*/
+
+			for (uint32_t i = 1; i < n; i++) {
+				pt_entry = target_buffer_get_u64(t, entry_buffer + 8 * i);
+				if (pt_entry & 0x0000000000000001)
+					tlb_insert(x86_32, (addr & 0xFFFFF000) + (i << 12),
+							(uint32_t)(pt_entry & 0x00000000FFFFF000), 0x00000FFF);
+			}
 		}
 	} else {
 		uint32_t pd_base = cr3 & 0xFFFFF000; /* lower 12 bits of CR3 must always be 0 */
@@ -552,15 +631,16 @@ int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *ph
 		 */
 		if (pd_entry & 0x00000080) {
 			/* 4MB pages */
-			uint32_t page_base = pd_entry & 0xFFC00000;
-			*physaddr = page_base + (addr & 0x003FFFFF);
+			*page_base = pd_entry & 0xFFC00000;
+			*page_mask = 0x003FFFFF;
 
 		} else {
 			/* 4KB pages */
 			uint32_t pt_base = pd_entry & 0xFFFFF000; /* A[31:12] is PageTable/Page Base Address */
 			uint32_t pt_index = (addr & 0x003FF000) >> 12; /* A[21:12] index to page table entry */
 			uint32_t pt_addr = pt_base + (4 * pt_index);
-			if (x86_32_common_read_phys_mem(t, pt_addr, 4, 1, entry_buffer) != ERROR_OK) {
+			uint32_t n = MIN(X86_32_TLB_PREFETCH, 1024 - pt_index);
+			if (x86_32_common_read_phys_mem(t, pt_addr, 4, n, entry_buffer) != ERROR_OK) {
 				LOG_ERROR("%s couldn't read page table entry at 0x%08" PRIx32, __func__, pt_addr);
 				return ERROR_FAIL;
 			}
@@ -569,9 +649,148 @@ int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *ph
 				LOG_ERROR("%s page table entry at 0x%08" PRIx32 " is not present", __func__, pt_addr);
 				return ERROR_FAIL;
 			}
-			uint32_t page_base = pt_entry & 0xFFFFF000; /* A[31:12] is PageTable/Page Base Address */
-			*physaddr = page_base + (addr & 0x00000FFF); /* A[11:0] offset to 4KB page in linear address */
+			*page_base = pt_entry & 0xFFFFF000; /* A[31:12] is PageTable/Page Base Address */
+			*page_mask = 0x00000FFF; /* A[11:0] offset to 4KB page in linear address */
+
+			for (uint32_t i = 1; i < n; i++) {
+				pt_entry = target_buffer_get_u32(t, entry_buffer + 4 * i);
+				if (pt_entry & 0x00000001)
+					tlb_insert(x86_32, (addr & 0xFFFFF000) + (i << 12),
+							pt_entry & 0xFFFFF000, 0x00000FFF);
+			}
+		}
+	}
+	tlb_insert(x86_32, addr, *page_base, *page_mask);
+	return ERROR_OK;
+}
+
+/* translate a linear address through the cache, page_mask gets the offset
+ * bits of the page it is in */
+static int lin_to_phys(struct target *t, uint32_t addr, uint32_t *physaddr,
+			uint32_t *page_mask)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+
+	/* the cache only holds translations for the current tables */
+	uint32_t cr3 = buf_get_u32(x86_32->cache->reg_list[CR3].value, 0, 32);
+	uint32_t cr4 = buf_get_u32(x86_32->cache->reg_list[CR4].value, 0, 32);
+	if (cr3 != x86_32->tlb_cr3 || cr4 != x86_32->tlb_cr4) {
+		x86_32_common_invalidate_tlb(t);
+		x86_32->tlb_cr3 = cr3;
+		x86_32->tlb_cr4 = cr4;
+	}
+
+	uint32_t page_base;
+	uint32_t mask;
+	struct x86_32_tlb_entry *entry = tlb_lookup(x86_32, addr);
+	if (entry) {
+		page_base = entry->phys;
+		mask = entry->mask;
+	} else {
+		int retval = walk_page_tables(t, addr, &page_base, &mask);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	*physaddr = page_base + (addr & mask);
+	if (page_mask)
+		*page_mask = mask;
+	return ERROR_OK;
+}
+
+int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *physaddr)
+{
+	if (physaddr == NULL || t == NULL)
+		return ERROR_FAIL;
+
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+
+	/* The 'user-visible' CR0.PG should be set - otherwise the function shouldn't be called
+	 * (Don't check the CR0.PG on the target, this might be temporally disabled at this point)
+	 */
+	uint32_t cr0 = buf_get_u32(x86_32->cache->reg_list[CR0].value, 0, 32);
+	if (!(cr0 & CR0_PG)) {
+		/* you are wrong in this function, never mind */
+		*physaddr = addr;
+		return ERROR_OK;
+	}
+
+	uint32_t phys;
+	int retval = lin_to_phys(t, addr, &phys, NULL);
+	if (retval != ERROR_OK)
+		return retval;
+	*physaddr = phys;
+	return ERROR_OK;
+}
+
+/* Read linear memory with paging already disabled. The physical address is
+ * recalculated at every page boundary, an element straddling a boundary is
+ * read a byte at a time.
+ */
+static int read_linear_mem(struct target *t, uint32_t addr,
+			uint32_t size, uint32_t count, uint8_t *buf)
+{
+	while (count) {
+		uint32_t physaddr;
+		uint32_t page_mask;
+		int retval = lin_to_phys(t, addr, &physaddr, &page_mask);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s failed to calculate physical address from 0x%08" PRIx32,
+					__func__, addr);
+			return retval;
+		}
+
+		uint32_t n = ((page_mask - (addr & page_mask)) + 1) / size;
+		if (n == 0) {
+			n = 1;
+			retval = read_linear_mem(t, addr, 1, size, buf);
+		} else {
+			n = MIN(n, count);
+			retval = x86_32_common_read_phys_mem(t, physaddr, size, n, buf);
+			if (retval != ERROR_OK)
+				LOG_ERROR("%s failed to read memory from physical address 0x%08" PRIx32,
+						__func__, physaddr);
 		}
+		if (retval != ERROR_OK)
+			return retval;
+
+		addr += n * size;
+		buf += n * size;
+		count -= n;
+	}
+	return ERROR_OK;
+}
+
+/* like read_linear_mem(), for writes */
+static int write_linear_mem(struct target *t, uint32_t addr,
+			uint32_t size, uint32_t count, const uint8_t *buf)
+{
+	while (count) {
+		uint32_t physaddr;
+		uint32_t page_mask;
+		int retval = lin_to_phys(t, addr, &physaddr, &page_mask);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s failed to calculate physical address from 0x%08" PRIx32,
+					__func__, addr);
+			return retval;
+		}
+
+		uint32_t n = ((page_mask - (addr & page_mask)) + 1) / size;
+		if (n == 0) {
+			n = 1;
+			retval = write_linear_mem(t, addr, 1, size, buf);
+		} else {
+			n = MIN(n, count);
+			retval = write_phys_mem_swbp(t, physaddr, size, n, buf);
+			if (retval != ERROR_OK)
+				LOG_ERROR("%s failed to write memory to physical address 0x%08" PRIx32,
+						__func__, physaddr);
+		}
+		if (retval != ERROR_OK)
+			return retval;
+
+		addr += n * size;
+		buf += n * size;
+		count -= n;
 	}
 	return ERROR_OK;
 }
@@ -592,34 +811,20 @@ int x86_32_common_read_memory(struct target *t, target_addr_t addr,
 
 	if (x86_32->is_paging_enabled(t)) {
 		/* all memory accesses from debugger must be physical (CR0.PG == 0)
-		 * conversion to physical address space needed
+		 * conversion to physical address space needed, paging stays off
+		 * for the whole transfer
 		 */
 		retval = x86_32->disable_paging(t);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("%s could not disable paging", __func__);
 			return retval;
 		}
-		target_addr_t physaddr = 0;
-		if (calcaddr_physfromlin(t, addr, &physaddr) != ERROR_OK) {
-			LOG_ERROR("%s failed to calculate physical address from " TARGET_ADDR_FMT,
-					  __func__, addr);
-			retval = ERROR_FAIL;
-		}
-		/* TODO: !!! Watch out for page boundaries
-		 * for every 4kB, the physical address has to be re-calculated
-		 * This should be fixed together with bulk memory reads
-		 */
-
-		if (retval == ERROR_OK
-			&& x86_32_common_read_phys_mem(t, physaddr, size, count, buf) != ERROR_OK) {
-			LOG_ERROR("%s failed to read memory from physical address " TARGET_ADDR_FMT,
-					  __func__, physaddr);
-		}
+		retval = read_linear_mem(t, addr, size, count, buf);
 		/* restore PG bit if it was cleared prior (regardless of retval) */
-		retval = x86_32->enable_paging(t);
-		if (retval != ERROR_OK) {
+		int retval2 = x86_32->enable_paging(t);
+		if (retval2 != ERROR_OK) {
 			LOG_ERROR("%s could not enable paging", __func__);
-			return retval;
+			return retval2;
 		}
 	} else {
 		/* paging is off - linear address is physical address */
@@ -648,33 +853,22 @@ int x86_32_common_write_memory(struct target *t, target_addr_t addr,
 	}
 	if (x86_32->is_paging_enabled(t)) {
 		/* all memory accesses from debugger must be physical (CR0.PG == 0)
-		 * conversion to physical address space needed
+		 * conversion to physical address space needed, paging stays off
+		 * for the whole transfer
 		 */
 		retval = x86_32->disable_paging(t);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("%s could not disable paging", __func__);
 			return retval;
 		}
-		target_addr_t physaddr = 0;
-		if (calcaddr_physfromlin(t, addr, &physaddr) != ERROR_OK) {
-			LOG_ERROR("%s failed to calculate physical address from " TARGET_ADDR_FMT,
-					__func__, addr);
-			retval = ERROR_FAIL;
-		}
-		/* TODO: !!! Watch out for page boundaries
-		 * for every 4kB, the physical address has to be re-calculated
-		 * This should be fixed together with bulk memory reads
-		 */
-		if (retval == ERROR_OK
-			&& x86_32_common_write_phys_mem(t, physaddr, size, count, buf) != ERROR_OK) {
-			LOG_ERROR("%s failed to write memory to physical address " TARGET_ADDR_FMT,
-					__func__, physaddr);
-		}
+		retval = write_linear_mem(t, addr, size, count, buf);
+		/* the write may have hit the page tables */
+		x86_32_common_invalidate_tlb(t);
 		/* restore PG bit if it was cleared prior (regardless of retval) */
-		retval = x86_32->enable_paging(t);
-		if (retval != ERROR_OK) {
+		int retval2 = x86_32->enable_paging(t);
+		if (retval2 != ERROR_OK) {
 			LOG_ERROR("%s could not enable paging", __func__);
-			return retval;
+			return retval2;
 		}
 	} else {
 
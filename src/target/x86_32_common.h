@@ -207,6 +207,18 @@ struct swbp_mem_patch {
 	struct swbp_mem_patch *next;
 };
 
+/* cached linear to physical page translation */
+struct x86_32_tlb_entry {
+	bool valid;
+	uint32_t lin;		/* linear page base */
+	uint32_t phys;		/* physical page base */
+	uint32_t mask;		/* offset bits of the page, 4KB, 2MB or 4MB */
+};
+
+#define X86_32_TLB_SIZE		64
+/* page table entries read per walk, for the pages following the one missed */
+#define X86_32_TLB_PREFETCH	16
+
 /* TODO - probemode specific - consider removing */
 #define NUM_PM_REGS		18 /* regs used in save/restore */
 
@@ -230,6 +242,12 @@ struct x86_32_common {
 	struct x86_32_dbg_reg *hw_break_list;
 	struct swbp_mem_patch *swbbp_mem_patch_list;
 
+	/* translations done since the last halt, for the CR3 and CR4 below */
+	struct x86_32_tlb_entry tlb[X86_32_TLB_SIZE];
+	unsigned int tlb_next;
+	uint32_t tlb_cr3;
+	uint32_t tlb_cr4;
+
 	/* core probemode implementation dependent functions */
 	uint8_t (*get_num_user_regs)(struct target *t);
 	bool (*is_paging_enabled)(struct target *t);
@@ -242,6 +260,12 @@ struct x86_32_common {
 	int (*write_hw_reg)(struct target *t, int reg,
 				uint32_t regval, uint8_t cache);
 
+	/* queued variants for batches of accesses with flush cleared, the
+	 * captured values are valid after jtag_execute_queue() */
+	int (*queue_read_hw_reg)(struct target *t, int reg, uint8_t *regbuf);
+	int (*queue_transaction_status)(struct target *t, uint8_t *tapstatus);
+	int (*check_transaction_status)(struct target *t, uint32_t tapstatus);
+
 	/* register cache to processor synchronization */
 	int (*read_hw_reg_to_cache)(struct target *target, int num);
 	int (*write_hw_reg_from_cache)(struct target *target, int num);
@@ -311,6 +335,7 @@ int x86_32_common_init_arch_info(struct target *target,
 			struct x86_32_common *x86_32);
 int x86_32_common_mmu(struct target *t, int *enabled);
 int x86_32_common_virt2phys(struct target *t, target_addr_t address, target_addr_t *physical);
+void x86_32_common_invalidate_tlb(struct target *t);
 int x86_32_common_read_phys_mem(struct target *t, target_addr_t phys_address,
 			uint32_t size, uint32_t count, uint8_t *buffer);
 int x86_32_common_write_phys_mem(struct target *t, target_addr_t phys_address,